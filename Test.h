@@ -6,27 +6,94 @@
 #include <ostream>
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <concepts>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <coroutine>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <random>
+#include <ranges>
+#include <set>
+#include <span>
+#include <sstream>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#if defined(__linux__)
+#include <dlfcn.h>
+#include <linux/perf_event.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace TDD
 {
-    static std::ostream *outStream = &std::cout; // default
+    inline std::ostream *outStream = &std::cout; // default, shared by every translation unit
 
     // Forward declarations
     class ConfirmException;
     class ActualConfirmException;
     class BoolConfirmException;
+    class SnapshotConfirmException;
     class MissingException;
     class TestBase;
     class Runner;
     class Test;
     class TestSuite;
+    class Tracer;
+    struct RunOptions;
+    class EventLoop;
+    class ThreadConfirms;
+    class ReasonArena;
+    class CoverageMap;
 
     inline void setOutStream(std::ostream &os);
-    inline std::map<std::string, std::vector<Test *>> &getTests();
-    inline std::map<std::string, std::vector<TestSuite *>> &getTestSuites();
+    inline std::map<std::string_view, std::vector<Test *>> &getTests();
+    inline std::map<std::string_view, std::vector<TestSuite *>> &getTestSuites();
     inline void addTest(std::string_view suiteName, Test *test);
     inline void addTestSuite(std::string_view suiteName, TestSuite *suite);
+    inline void removeTest(std::string_view suiteName, Test *test);
+    inline void removeTestSuite(std::string_view suiteName, TestSuite *suite);
     inline void runTests();
+    inline int runTests(int argc, const char **argv);
+    inline Tracer &getTracer();
+    inline RunOptions &getRunOptions();
+    inline EventLoop &getEventLoop();
+    inline ThreadConfirms &getThreadConfirms();
+    inline ReasonArena &getReasonArena();
+    inline CoverageMap &getCoverageMap();
 
     class ConfirmException
     {
@@ -49,22 +116,19 @@ namespace TDD
     {
     public:
         ActualConfirmException(std::string_view expected, std::string_view actual, int line)
-            : ConfirmException(line),
-              mExpected(expected),
-              mActual(actual)
+            : ConfirmException(line)
         {
-            formatReason();
+            formatReason(expected, actual);
         }
 
     private:
-        void formatReason()
+        void formatReason(std::string_view expected, std::string_view actual)
         {
-            mReason += "    Expected: " + mExpected + "\n";
-            mReason += "    Actual  : " + mActual;
+            mReason += "    Expected: ";
+            mReason += expected;
+            mReason += "\n    Actual  : ";
+            mReason += actual;
         }
-        int mLine;
-        std::string mExpected;
-        std::string mActual;
     };
 
     class BoolConfirmException : public ConfirmException
@@ -77,6 +141,25 @@ namespace TDD
         }
     };
 
+    class SnapshotConfirmException : public ConfirmException
+    {
+    public:
+        SnapshotConfirmException(std::string_view message, int line) : ConfirmException(line)
+        {
+            mReason += "    Snapshot: ";
+            mReason += message;
+        }
+
+        SnapshotConfirmException(std::string_view message, std::string_view expected, std::string_view actual, int line)
+            : SnapshotConfirmException(message, line)
+        {
+            mReason += "\n    Expected: ";
+            mReason += expected;
+            mReason += "\n    Actual  : ";
+            mReason += actual;
+        }
+    };
+
     class MissingException
     {
     public:
@@ -88,502 +171,5075 @@ namespace TDD
         std::string mExceptionType;
     };
 
-    class TestBase
+    inline std::string formatDuration(std::chrono::nanoseconds duration)
     {
-    public:
-        TestBase(std::string_view name, std::string_view suiteName)
-            : mName(name),
-              mSuiteName(suiteName),
-              mPassed(true),
-              mConfirmLocation(-1) {}
-
-        virtual ~TestBase() = default;
-
-        std::string_view name() const { return mName; }
+        double value = static_cast<double>(duration.count());
+        std::string_view unit = "ns";
+        if (value >= 1e9)
+        {
+            value /= 1e9;
+            unit = "s";
+        }
+        else if (value >= 1e6)
+        {
+            value /= 1e6;
+            unit = "ms";
+        }
+        else if (value >= 1e3)
+        {
+            value /= 1e3;
+            unit = "us";
+        }
+        std::ostringstream os;
+        os << std::setprecision(3) << value << unit;
+        return os.str();
+    }
 
-        std::string_view suiteName() const { return mSuiteName; }
+    // Collects confirms that fail on threads other than the one running the
+    // current test. Throwing there would reach std::terminate, so the
+    // failure is kept and the Runner attaches it to the test when it ends.
+    // The confirm then returns, and the thread keeps running the code after
+    // it. Threads that outlive their test report into whichever test runs
+    // next.
+    class ThreadConfirms
+    {
+    public:
+        struct Capture
+        {
+            std::chrono::steady_clock::time_point time;
+            std::string reason;
+            int line;
+        };
 
-        std::string_view reason() const { return mReason; }
+        void begin()
+        {
+            std::lock_guard lock(mMutex);
+            mCaptures.clear();
+            mOwner.store(std::this_thread::get_id(), std::memory_order_release);
+        }
 
-        bool passed() const { return mPassed; }
+        // Confirms throw again on every thread, but the captures are kept
+        // until the next begin.
+        void stop()
+        {
+            mOwner.store(std::thread::id(), std::memory_order_release);
+        }
 
-        int confirmLocation() const { return mConfirmLocation; }
+        void end(TestBase *test);
 
-        void setFailed(std::string_view reason, int confirmLocation = -1)
+        // Confirms throw as usual on the test's thread and when no test is
+        // running, and in STRESS workers, which catch what they throw.
+        bool onOwnerThread() const
         {
-            mPassed = false;
-            mReason = reason;
-            mConfirmLocation = confirmLocation;
+            std::thread::id owner = mOwner.load(std::memory_order_acquire);
+            return owner == std::thread::id() || owner == std::this_thread::get_id() || throwsOnThisThread();
         }
 
-    private:
-        std::string mName;
-        std::string mSuiteName;
-        std::string mReason;
-        bool mPassed;
-        int mConfirmLocation;
-    };
-
-    class Test : public TestBase
-    {
-    public:
-        Test(std::string_view name, std::string_view suiteName)
-            : TestBase(name, suiteName)
+        static bool &throwsOnThisThread()
         {
-            addTest(suiteName, this);
+            thread_local bool throws = false;
+
+            return throws;
         }
-        virtual void runEx()
+
+        void capture(std::string_view reason, int line)
         {
-            run();
+            auto time = std::chrono::steady_clock::now();
+            std::lock_guard lock(mMutex);
+            mCaptures.push_back({time, std::string(reason), line});
         }
-        virtual void run() = 0;
 
-        std::string_view expectedReason() const { return mExpectedReason; }
+        int count() const
+        {
+            std::lock_guard lock(mMutex);
+            return static_cast<int>(mCaptures.size());
+        }
 
-        void setExpectedFailureReason(std::string_view reason)
+        // The first failure captured while an async test's coroutine was
+        // running. Interleaved tests share the loop thread, so a failure
+        // fails every async test that was running when it was captured.
+        std::optional<Capture> firstBetween(std::chrono::steady_clock::time_point begin,
+                                            std::chrono::steady_clock::time_point end) const
         {
-            mExpectedReason = reason;
+            std::lock_guard lock(mMutex);
+            for (auto const &capture : mCaptures)
+            {
+                if (capture.time >= begin && capture.time <= end)
+                {
+                    return capture;
+                }
+            }
+            return std::nullopt;
         }
 
     private:
-        std::string mName;
-        std::string mSuiteName;
-        std::string mExpectedReason;
+        std::atomic<std::thread::id> mOwner;
+        mutable std::mutex mMutex;
+        std::vector<Capture> mCaptures;
     };
 
     template <typename ExceptionT>
-    class TestEx : public Test
+    void raiseConfirm(ExceptionT const &ex)
     {
-    public:
-        TestEx(std::string_view name, std::string_view suiteName, std::string_view exceptionName)
-            : Test(name, suiteName), mExceptionName(exceptionName) {}
-
-        void runEx() override
+        if (getThreadConfirms().onOwnerThread())
         {
-            try
-            {
-                run();
-            }
-            catch (ExceptionT const &)
-            {
-                return;
-            }
-            throw MissingException(mExceptionName);
+            throw ex;
         }
+        getThreadConfirms().capture(ex.reason(), ex.line());
+    }
 
-    private:
-        std::string_view mExceptionName;
+    // Resources used while a single test ran. Hardware counters stay at -1
+    // when perf events are unavailable, as in most containers and VMs.
+    struct ResourceCounters
+    {
+        std::int64_t cycles = -1;
+        std::int64_t instructions = -1;
+        std::int64_t cacheMisses = -1;
+        std::int64_t branchMisses = -1;
+        std::int64_t pageFaults = 0;
+        std::int64_t contextSwitches = 0;
+        std::int64_t maxRssKb = 0;
+        bool sampled = false;
+
+        bool hasHardware() const { return cycles >= 0 || instructions >= 0 || cacheMisses >= 0 || branchMisses >= 0; }
     };
 
-    class TestSuite : public TestBase
+    class CounterSampler
     {
     public:
-        TestSuite(std::string_view name, std::string_view suiteName)
-            : TestBase(name, suiteName)
+        CounterSampler()
         {
-            addTestSuite(suiteName, this);
+#if defined(__linux__)
+            mFds[0] = openHardware(PERF_COUNT_HW_CPU_CYCLES);
+            mFds[1] = openHardware(PERF_COUNT_HW_INSTRUCTIONS);
+            mFds[2] = openHardware(PERF_COUNT_HW_CACHE_MISSES);
+            mFds[3] = openHardware(PERF_COUNT_HW_BRANCH_MISSES);
+#endif
         }
-        virtual void suiteSetup() = 0;
-        virtual void suiteTeardown() = 0;
-    };
 
-    class Runner
-    {
-    private:
-        struct TestCounters
+        ~CounterSampler()
         {
-            int passed = 0;
-            int failed = 0;
-            int missedFailures = 0;
-        };
+#if defined(__linux__)
+            for (int fd : mFds)
+            {
+                if (fd != -1)
+                {
+                    close(fd);
+                }
+            }
+#endif
+        }
 
-    public:
-        static int runAllTests()
-        {
-            TestCounters counters;
-            *outStream << "Running " << getTests().size() << " test suites\n";
+        CounterSampler(CounterSampler const &) = delete;
+        CounterSampler &operator=(CounterSampler const &) = delete;
 
-            for (auto const &[suiteName, tests] : getTests())
+        bool hasHardware() const
+        {
+            for (int fd : mFds)
             {
-                printSuiteHeader(suiteName);
+                if (fd != -1)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
 
-                if (isSuiteNotFound(suiteName))
+        void start()
+        {
+#if defined(__linux__)
+            getrusage(RUSAGE_SELF, &mUsage);
+            for (int fd : mFds)
+            {
+                if (fd != -1)
                 {
-                    return ++counters.failed;
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
                 }
+            }
+#endif
+        }
 
-                if (!runSuiteSetup(suiteName, counters))
+        ResourceCounters stop()
+        {
+            ResourceCounters counters;
+#if defined(__linux__)
+            std::int64_t *values[] = {
+                &counters.cycles, &counters.instructions, &counters.cacheMisses, &counters.branchMisses};
+            for (int i = 0; i < eventCount; ++i)
+            {
+                if (mFds[i] == -1)
                 {
                     continue;
                 }
-
-                for (auto *test : tests)
+                ioctl(mFds[i], PERF_EVENT_IOC_DISABLE, 0);
+                std::uint64_t value = 0;
+                if (read(mFds[i], &value, sizeof(value)) == sizeof(value))
                 {
-                    runTest(test, counters);
+                    *values[i] = static_cast<std::int64_t>(value);
                 }
-
-                runSuiteTeardown(suiteName, counters);
             }
 
-            printTestSummary(counters);
-            return counters.failed;
+            rusage after{};
+            getrusage(RUSAGE_SELF, &after);
+            counters.pageFaults = (after.ru_minflt - mUsage.ru_minflt) + (after.ru_majflt - mUsage.ru_majflt);
+            counters.contextSwitches = (after.ru_nvcsw - mUsage.ru_nvcsw) + (after.ru_nivcsw - mUsage.ru_nivcsw);
+            counters.maxRssKb = after.ru_maxrss;
+            counters.sampled = true;
+#endif
+            return counters;
         }
 
     private:
-        static void printSuiteHeader(const std::string_view suiteName)
+        static constexpr int eventCount = 4;
+
+#if defined(__linux__)
+        static int openHardware(std::uint64_t config)
         {
-            std::string suiteDisplayName = "Suite: ";
-            suiteDisplayName += suiteName.empty() ? "Single Tests" : suiteName;
+            perf_event_attr attr{};
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
 
-            *outStream << "------------------ " << suiteDisplayName << std::endl;
+        rusage mUsage{};
+#endif
+        int mFds[eventCount] = {-1, -1, -1, -1};
+    };
+
+    inline std::ostream &operator<<(std::ostream &os, ResourceCounters const &counters)
+    {
+        auto hardware = [&](std::string_view label, std::int64_t value)
+        {
+            os << label;
+            if (value < 0)
+            {
+                os << "n/a";
+            }
+            else
+            {
+                os << value;
+            }
+        };
+        if (counters.hasHardware())
+        {
+            hardware("    Cycles: ", counters.cycles);
+            hardware("  Instructions: ", counters.instructions);
+            hardware("  Cache misses: ", counters.cacheMisses);
+            hardware("  Branch misses: ", counters.branchMisses);
+            os << "\n";
         }
+        os << "    Page faults: " << counters.pageFaults
+           << "  Context switches: " << counters.contextSwitches
+           << "  Max RSS: " << counters.maxRssKb << " KB";
+        return os;
+    }
+
+    struct RunOptions
+    {
+        bool counters = false;
+        int repeat = 1;
+        bool untilFail = false;
+        std::string filter;
+        std::set<std::string, std::less<>> quarantine;
+        std::set<const Test *> selected; // runs every test when empty
+        std::string watchDirectory;
+        std::string journalPath;
+        bool resume = false;
+        std::string snapshotDirectory = "snapshots";
+        bool updateSnapshots = false;
+        std::string historyPath;
+        std::string historyQuery;
+        bool queryHistory = false;
+        int historyRuns = 10;
+        std::string coverageMapPath;
+        std::string coverageDirectory = ".";
+        std::string changedFilesPath;
+        bool progress = true;
+
+        // --until-fail without --repeat stops after this many passing runs.
+        static constexpr int untilFailLimit = 1000;
+    };
+
+    // A whole span, recorded once it has ended, so a full buffer drops
+    // spans and never a begin without its end. Names must outlive the
+    // trace, which holds for string literals and for the names owned by
+    // registered tests.
+    struct TraceEvent
+    {
+        std::string_view name;
+        std::string_view category;
+        std::int64_t timestamp; // nanoseconds since tracing was enabled
+        std::int64_t duration;  // nanoseconds
+        ResourceCounters const *counters; // written as args when set
+        void const *id; // pairs the events of an async span
+        char phase; // 'X' for a nested span, 'b' for an async one
+    };
+
+    // Fixed-size ring buffer written by exactly one thread. Once full, the
+    // oldest spans are overwritten so recording never blocks or allocates.
+    class TraceBuffer
+    {
+    public:
+        static constexpr std::uint64_t capacity = 1 << 16; // must be a power of two
 
-        static void printTestSummary(const TestCounters &counters)
+        explicit TraceBuffer(int threadId)
+            : mThreadId(threadId),
+              mEvents(new TraceEvent[capacity]) {}
+
+        void record(std::string_view name, std::string_view category, char phase, std::int64_t timestamp,
+                    std::int64_t duration, ResourceCounters const *counters = nullptr, void const *id = nullptr)
         {
-            *outStream << "-------------------------" << std::endl;
+            std::uint64_t head = mHead.load(std::memory_order_relaxed);
+            mEvents[head & (capacity - 1)] = {name, category, timestamp, duration, counters, id, phase};
+            mHead.store(head + 1, std::memory_order_release);
+        }
 
-            *outStream << "Tests passed: " << counters.passed
-                       << "\nTests failed: " << counters.failed;
+        int threadId() const { return mThreadId; }
 
-            if (counters.missedFailures != 0)
+        void clear()
+        {
+            mHead.store(0, std::memory_order_release);
+        }
+
+        // Calls visit for the retained events, oldest first. Only meaningful
+        // once the owning thread has stopped recording.
+        template <typename VisitT>
+        void forEach(VisitT visit) const
+        {
+            std::uint64_t head = mHead.load(std::memory_order_acquire);
+            std::uint64_t first = head > capacity ? head - capacity : 0;
+            for (std::uint64_t i = first; i < head; ++i)
             {
-                *outStream << "\nMissed failures: " << counters.missedFailures;
+                visit(mEvents[i & (capacity - 1)]);
             }
-            *outStream << std::endl;
         }
 
-        static bool isSuiteNotFound(const std::string &suiteName)
+    private:
+        int mThreadId;
+        std::unique_ptr<TraceEvent[]> mEvents;
+        std::atomic<std::uint64_t> mHead{0};
+    };
+
+    class Tracer
+    {
+    public:
+        void enable(std::string_view path)
+        {
+            mPath = path;
+            mStart = clockNow();
+            mEnabled.store(true, std::memory_order_release);
+        }
+
+        bool enabled() const { return mEnabled.load(std::memory_order_relaxed); }
+
+        // Start of a span that record completes. Zero while tracing is
+        // off, so untraced runs do not read the clock.
+        std::int64_t begin() const
         {
-            if (not suiteName.empty() && not getTestSuites().contains(suiteName))
+            return enabled() ? clockNow() - mStart : 0;
+        }
+
+        // Records the span from begin until now.
+        void record(std::string_view name, std::string_view category, std::int64_t begin,
+                    ResourceCounters const *counters = nullptr)
+        {
+            if (not enabled())
             {
-                *outStream << "Test suite is not found. Exiting test application." << std::endl;
-                return true;
+                return;
             }
-            return false;
+            threadBuffer().record(name, category, 'X', begin, clockNow() - mStart - begin, counters);
         }
 
-        static bool runSuiteSetup(const std::string &suiteName, TestCounters &counters)
+        // Records a span measured earlier. Such spans may overlap, as the
+        // async tests on the event loop do, so they are written as async
+        // events that Chrome pairs by id instead of by nesting. The id must
+        // be unique among the overlapping spans, such as the test's address.
+        void recordSpan(std::string_view name, std::string_view category, void const *id,
+                        std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
         {
-            if (not suiteName.empty() && not runSuite(true, suiteName, counters))
+            if (not enabled())
             {
-                *outStream << "Test suite setup failed. Skipping tests in suite." << std::endl;
-                return false;
+                return;
             }
-            return true;
+            threadBuffer().record(name, category, 'b', sinceStart(begin), (end - begin).count(), nullptr, id);
         }
 
-        static bool runSuiteTeardown(const std::string &suiteName, TestCounters &counters)
+        // Writes every buffered event as Chrome/Perfetto trace JSON.
+        bool write()
         {
-            if (not suiteName.empty() && not runSuite(false, suiteName, counters))
+            if (not enabled())
+            {
+                return true;
+            }
+            std::ofstream file(mPath);
+            if (not file.is_open())
             {
-                *outStream << "Test suite teardown failed. Skipping tests in suite." << std::endl;
                 return false;
             }
-            return true;
+
+            std::lock_guard lock(mBuffersMutex);
+            file << "{\"traceEvents\":[";
+            bool first = true;
+            for (auto const &buffer : mBuffers)
+            {
+                buffer->forEach([&](TraceEvent const &event)
+                {
+                    file << (first ? "\n" : ",\n");
+                    first = false;
+                    writeEvent(file, event, buffer->threadId());
+                });
+            }
+            file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+            return file.good();
         }
 
-        static void runTest(Test *test, TestCounters &counters)
+        std::string_view path() const { return mPath; }
+
+        // Drops every buffered event. Only safe while no thread is recording,
+        // such as between runs before test shared objects are unloaded.
+        void clear()
         {
-            *outStream << "------------ Test: " << test->name() << std::endl;
-            handleTest(test);
-            updateTestCounters(test, counters);
+            std::lock_guard lock(mBuffersMutex);
+            for (auto &buffer : mBuffers)
+            {
+                buffer->clear();
+            }
         }
 
-        static bool runSuite(bool setup, std::string const &name, TestCounters &counters)
+    private:
+        static std::int64_t clockNow()
         {
-            bool result = true;
-            for (auto &suite : getTestSuites()[name])
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                .count();
+        }
+
+        std::int64_t sinceStart(std::chrono::steady_clock::time_point time) const
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count() - mStart;
+        }
+
+        TraceBuffer &threadBuffer()
+        {
+            thread_local TraceBuffer *buffer = nullptr;
+            if (buffer == nullptr)
             {
-                if (setup)
+                // Buffers are owned by the tracer so events recorded by
+                // threads that have already finished are still written.
+                std::lock_guard lock(mBuffersMutex);
+                mBuffers.push_back(std::make_unique<TraceBuffer>(static_cast<int>(mBuffers.size()) + 1));
+                buffer = mBuffers.back().get();
+            }
+            return *buffer;
+        }
+
+        static void writeString(std::ostream &os, std::string_view text)
+        {
+            os << '"';
+            for (char c : text)
+            {
+                if (c == '"' || c == '\\')
                 {
-                    *outStream << "------------ Setup: ";
+                    os << '\\' << c;
                 }
-                else
+                else if (static_cast<unsigned char>(c) < 0x20)
                 {
-                    *outStream << "------------ Teardown: ";
+                    os << ' ';
                 }
-                *outStream << suite->name() << std::endl;
-                handleSuite(suite, setup);
-                if (isSuiteFailed(suite, counters))
+                else
                 {
-                    return false;
+                    os << c;
                 }
             }
-            return result;
+            os << '"';
         }
 
-        static void handleMissingException(TestBase *test, const MissingException &ex)
+        // Chrome expects microseconds; keep the nanosecond precision as a fraction.
+        static void writeMicroseconds(std::ostream &os, std::int64_t nanoseconds)
         {
-            // Expected exception type int was not thrown
-            std::string message = "Expected exception type ";
-            message += ex.exceptionType();
-            message += " was not thrown.";
-            test->setFailed(message);
+            int fraction = static_cast<int>(nanoseconds % 1000);
+            os << nanoseconds / 1000 << '.'
+               << static_cast<char>('0' + fraction / 100)
+               << static_cast<char>('0' + fraction / 10 % 10)
+               << static_cast<char>('0' + fraction % 10);
         }
 
-        static void handleConfirmException(TestBase *test, const ConfirmException &ex)
+        // Async spans are written as the begin and end events Chrome pairs.
+        static void writeEvent(std::ostream &os, TraceEvent const &event, int threadId)
+        {
+            if (event.phase == 'b')
+            {
+                writeEvent(os, event, threadId, 'b', event.timestamp);
+                os << ",\n";
+                writeEvent(os, event, threadId, 'e', event.timestamp + event.duration);
+                return;
+            }
+            writeEvent(os, event, threadId, event.phase, event.timestamp);
+        }
+
+        static void writeEvent(std::ostream &os, TraceEvent const &event, int threadId, char phase,
+                               std::int64_t timestamp)
+        {
+            os << "{\"name\":";
+            writeString(os, event.name);
+            os << ",\"cat\":";
+            writeString(os, event.category);
+            os << ",\"ph\":\"" << phase << "\",\"ts\":";
+            writeMicroseconds(os, timestamp);
+            if (phase == 'X')
+            {
+                os << ",\"dur\":";
+                writeMicroseconds(os, event.duration);
+            }
+            os << ",\"pid\":1,\"tid\":" << threadId;
+            if (phase == 'b' || phase == 'e')
+            {
+                os << ",\"id\":\"" << event.id << '"';
+            }
+            if (event.counters != nullptr && event.counters->sampled)
+            {
+                writeCounters(os, *event.counters);
+            }
+            os << "}";
+        }
+
+        static void writeCounters(std::ostream &os, ResourceCounters const &counters)
+        {
+            os << ",\"args\":{\"pageFaults\":" << counters.pageFaults
+               << ",\"contextSwitches\":" << counters.contextSwitches
+               << ",\"maxRssKb\":" << counters.maxRssKb;
+            std::pair<char const *, std::int64_t> hardware[] = {
+                {"cycles", counters.cycles},
+                {"instructions", counters.instructions},
+                {"cacheMisses", counters.cacheMisses},
+                {"branchMisses", counters.branchMisses}};
+            for (auto const &[label, value] : hardware)
+            {
+                if (value >= 0)
+                {
+                    os << ",\"" << label << "\":" << value;
+                }
+            }
+            os << "}";
+        }
+
+        std::atomic<bool> mEnabled{false};
+        std::int64_t mStart = 0;
+        std::string mPath;
+        std::mutex mBuffersMutex;
+        std::vector<std::unique_ptr<TraceBuffer>> mBuffers;
+    };
+
+    // Records a span from now until it goes out of scope.
+    class TraceScope
+    {
+    public:
+        explicit TraceScope(std::string_view name, std::string_view category = "user")
+            : mName(name), mCategory(category), mBegin(getTracer().begin()) {}
+
+        ~TraceScope()
+        {
+            getTracer().record(mName, mCategory, mBegin);
+        }
+
+        TraceScope(TraceScope const &) = delete;
+        TraceScope &operator=(TraceScope const &) = delete;
+
+    private:
+        std::string_view mName;
+        std::string_view mCategory;
+        std::int64_t mBegin;
+    };
+
+    // Owns the failure reasons of a run. Text is only copied here when a
+    // test fails or declares an expected failure, and all of it is released
+    // at once when the next run starts, or between the runs of a repeated
+    // test. Used from the Runner thread only.
+    class ReasonArena
+    {
+    public:
+        std::string_view store(std::string_view text)
+        {
+            if (text.empty())
+            {
+                return {};
+            }
+            if (mBlocks.empty() || mUsed + text.size() > mBlocks.back().size)
+            {
+                std::size_t size = std::max(blockSize, text.size());
+                mBlocks.push_back({std::make_unique<char[]>(size), size});
+                mUsed = 0;
+            }
+            char *destination = mBlocks.back().data.get() + mUsed;
+            std::memcpy(destination, text.data(), text.size());
+            mUsed += text.size();
+            return {destination, text.size()};
+        }
+
+        // Invalidates every stored reason. The first block is kept for reuse.
+        void reset()
+        {
+            if (mBlocks.size() > 1)
+            {
+                mBlocks.resize(1);
+            }
+            mUsed = 0;
+        }
+
+        // Position to roll back to with release.
+        struct Mark
+        {
+            std::size_t blocks = 0;
+            std::size_t used = 0;
+        };
+
+        Mark mark() const { return {mBlocks.size(), mUsed}; }
+
+        // Invalidates every reason stored since the mark was taken, so the
+        // runs of a repeated test reuse the same memory.
+        void release(Mark mark)
+        {
+            if (mBlocks.size() > std::max<std::size_t>(mark.blocks, 1))
+            {
+                mBlocks.resize(std::max<std::size_t>(mark.blocks, 1));
+            }
+            mUsed = mark.blocks == 0 ? 0 : mark.used;
+        }
+
+        std::size_t blockCount() const { return mBlocks.size(); }
+
+    private:
+        static constexpr std::size_t blockSize = 16 * 1024;
+
+        struct Block
+        {
+            std::unique_ptr<char[]> data;
+            std::size_t size;
+        };
+
+        std::vector<Block> mBlocks;
+        std::size_t mUsed = 0;
+    };
+
+    class TestBase
+    {
+    public:
+        TestBase(std::string_view name, std::string_view suiteName)
+            : mName(name),
+              mSuiteName(suiteName),
+              mConfirmLocation(-1),
+              mPassed(true) {}
+
+        virtual ~TestBase() = default;
+
+        std::string_view name() const { return mName; }
+
+        std::string_view suiteName() const { return mSuiteName; }
+
+        std::string_view reason() const { return mReason; }
+
+        bool passed() const { return mPassed; }
+
+        int confirmLocation() const { return mConfirmLocation; }
+
+        ResourceCounters const &counters() const
+        {
+            static ResourceCounters const notSampled;
+
+            return mCounters ? *mCounters : notSampled;
+        }
+
+        std::chrono::nanoseconds duration() const { return mDuration; }
+
+        void setDuration(std::chrono::nanoseconds duration)
+        {
+            mDuration = duration;
+        }
+
+        void setCounters(ResourceCounters const &counters)
+        {
+            if (mCounters)
+            {
+                *mCounters = counters;
+            }
+            else
+            {
+                mCounters = std::make_unique<ResourceCounters>(counters);
+            }
+        }
+
+        void setFailed(std::string_view reason, int confirmLocation = -1)
+        {
+            mPassed = false;
+            mReason = getReasonArena().store(reason);
+            mConfirmLocation = confirmLocation;
+        }
+
+        void resetResult()
+        {
+            mPassed = true;
+            mReason = {};
+            mConfirmLocation = -1;
+        }
+
+    private:
+        // Names view the string literals passed to the test macros, and the
+        // reason views the ReasonArena. Counters are only allocated when sampled.
+        std::string_view mName;
+        std::string_view mSuiteName;
+        std::string_view mReason;
+        std::chrono::nanoseconds mDuration{0};
+        std::unique_ptr<ResourceCounters> mCounters;
+        int mConfirmLocation;
+        bool mPassed;
+    };
+
+    inline void ThreadConfirms::end(TestBase *test)
+    {
+        stop();
+        std::lock_guard lock(mMutex);
+        if (not mCaptures.empty() && test->passed())
+        {
+            test->setFailed(mCaptures.front().reason, mCaptures.front().line);
+        }
+    }
+
+    class Test : public TestBase
+    {
+    public:
+        Test(std::string_view name, std::string_view suiteName)
+            : TestBase(name, suiteName)
+        {
+            addTest(suiteName, this);
+        }
+
+        // Tests in a shared object unregister when it is unloaded.
+        ~Test() override
+        {
+            removeTest(suiteName(), this);
+        }
+
+        virtual void runEx()
+        {
+            run();
+        }
+        virtual void run() = 0;
+
+        std::string_view expectedReason() const { return mExpectedReason; }
+
+        void setExpectedFailureReason(std::string_view reason)
+        {
+            mExpectedReason = getReasonArena().store(reason);
+        }
+
+    private:
+        std::string_view mExpectedReason;
+    };
+
+    template <typename ExceptionT>
+    class TestEx : public Test
+    {
+    public:
+        TestEx(std::string_view name, std::string_view suiteName, std::string_view exceptionName)
+            : Test(name, suiteName), mExceptionName(exceptionName) {}
+
+        void runEx() override
+        {
+            try
+            {
+                run();
+            }
+            catch (ExceptionT const &)
+            {
+                return;
+            }
+            throw MissingException(mExceptionName);
+        }
+
+    private:
+        std::string_view mExceptionName;
+    };
+
+    class TestSuite : public TestBase
+    {
+    public:
+        TestSuite(std::string_view name, std::string_view suiteName)
+            : TestBase(name, suiteName)
+        {
+            addTestSuite(suiteName, this);
+        }
+
+        ~TestSuite() override
+        {
+            removeTestSuite(suiteName(), this);
+        }
+
+        virtual void suiteSetup() = 0;
+        virtual void suiteTeardown() = 0;
+    };
+
+    // How the Runner reported a test. Stored in the journal because the
+    // expected failure reason is only known while the test runs.
+    enum class TestOutcome : std::uint8_t
+    {
+        Passed,
+        Failed,
+        ExpectedFailure,
+        MissedFailure,
+        Quarantined
+    };
+
+    inline std::uint32_t crc32(std::string_view data)
+    {
+        static auto const table = []
+        {
+            std::array<std::uint32_t, 256> values{};
+            for (std::uint32_t i = 0; i < 256; ++i)
+            {
+                std::uint32_t value = i;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+                }
+                values[i] = value;
+            }
+            return values;
+        }();
+
+        std::uint32_t crc = 0xffffffffu;
+        for (unsigned char c : data)
+        {
+            crc = table[(crc ^ c) & 0xff] ^ (crc >> 8);
+        }
+        return crc ^ 0xffffffffu;
+    }
+
+    // Appends and reads fixed-size values in native byte order. Journal and
+    // history files are only meant to be read on the machine that wrote them.
+    template <typename T>
+    void appendValue(std::string &out, T value)
+    {
+        char bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        out.append(bytes, sizeof(T));
+    }
+
+    inline void appendText(std::string &out, std::string_view text)
+    {
+        appendValue(out, static_cast<std::uint32_t>(text.size()));
+        out.append(text);
+    }
+
+    class ByteReader
+    {
+    public:
+        explicit ByteReader(std::string_view data) : mData(data) {}
+
+        template <typename T>
+        bool read(T &value)
+        {
+            if (mData.size() < sizeof(T))
+            {
+                return false;
+            }
+            std::memcpy(&value, mData.data(), sizeof(T));
+            mData.remove_prefix(sizeof(T));
+            return true;
+        }
+
+        bool readText(std::string_view &text)
+        {
+            std::uint32_t size = 0;
+            if (not read(size) || mData.size() < size)
+            {
+                return false;
+            }
+            text = mData.substr(0, size);
+            mData.remove_prefix(size);
+            return true;
+        }
+
+        std::string_view take(std::size_t size)
+        {
+            std::string_view part = mData.substr(0, size);
+            mData.remove_prefix(part.size());
+            return part;
+        }
+
+        std::size_t remaining() const { return mData.size(); }
+
+    private:
+        std::string_view mData;
+    };
+
+    // Memory mapped, append-only file of checksummed records. Each record
+    // is a 32-bit payload length, a CRC-32 of the payload, then the payload.
+    // The file grows in zero-filled chunks, so a zero length marks the end
+    // of the data. A torn or corrupt record ends the valid data, and
+    // everything after it is discarded when the file is reopened.
+    class RecordFile
+    {
+    public:
+        RecordFile() = default;
+        RecordFile(RecordFile const &) = delete;
+        RecordFile &operator=(RecordFile const &) = delete;
+
+        ~RecordFile()
+        {
+            close();
+        }
+
+        // Opens or creates path. Existing records are passed to visit.
+        // Returns false when the file cannot be used.
+        template <typename VisitT>
+        bool open(std::string const &path, std::string_view magic, bool keepRecords, VisitT visit)
+        {
+#if defined(__linux__)
+            close();
+            mFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            struct stat info{};
+            if (mFd == -1 || fstat(mFd, &info) == -1)
+            {
+                return false;
+            }
+            mMagic = magic;
+            mSize = 0;
+            mDiscarded = 0;
+            if (keepRecords && static_cast<std::size_t>(info.st_size) >= magic.size())
+            {
+                if (not map(static_cast<std::size_t>(info.st_size)))
+                {
+                    return false;
+                }
+                mSize = validRecordsEnd(visit);
+                mDiscarded = recordedBytesAfter(mSize);
+            }
+            if (mSize == 0)
+            {
+                if (not reserve(magic.size()))
+                {
+                    return false;
+                }
+                std::memcpy(mData, magic.data(), magic.size());
+                mSize = magic.size();
+            }
+            // Zero whatever followed the valid records so it cannot be
+            // mistaken for data once new records are appended.
+            std::memset(mData + mSize, 0, mCapacity - mSize);
+            return true;
+#else
+            (void)path;
+            (void)magic;
+            (void)keepRecords;
+            (void)visit;
+            return false;
+#endif
+        }
+
+        bool append(std::string_view payload)
+        {
+#if defined(__linux__)
+            std::size_t needed = mSize + 2 * sizeof(std::uint32_t) + payload.size();
+            if (mFd == -1 || not reserve(needed))
+            {
+                return false;
+            }
+            auto length = static_cast<std::uint32_t>(payload.size());
+            std::uint32_t checksum = crc32(payload);
+            // The length is written last so a reader never sees a complete
+            // header in front of a partially written payload.
+            std::memcpy(mData + mSize + 2 * sizeof(std::uint32_t), payload.data(), payload.size());
+            std::memcpy(mData + mSize + sizeof(std::uint32_t), &checksum, sizeof(checksum));
+            std::memcpy(mData + mSize, &length, sizeof(length));
+            mSize = needed;
+            if (++mUnsynced >= syncBatch)
+            {
+                sync();
+            }
+            return true;
+#else
+            (void)payload;
+            return false;
+#endif
+        }
+
+        // Flushes appended records to disk.
+        void sync()
+        {
+#if defined(__linux__)
+            if (mData != nullptr && mUnsynced != 0)
+            {
+                msync(mData, mSize, MS_SYNC);
+            }
+#endif
+            mUnsynced = 0;
+        }
+
+        void close()
+        {
+#if defined(__linux__)
+            if (mFd == -1)
+            {
+                return;
+            }
+            sync();
+            munmap(mData, mCapacity);
+            if (ftruncate(mFd, static_cast<off_t>(mSize)) == 0)
+            {
+                fsync(mFd);
+            }
+            ::close(mFd);
+            mFd = -1;
+            mData = nullptr;
+            mCapacity = 0;
+#endif
+        }
+
+        bool isOpen() const { return mFd != -1; }
+
+        // Bytes of torn or corrupt records dropped when the file was opened.
+        std::size_t discarded() const { return mDiscarded; }
+
+    private:
+        static constexpr std::size_t growBy = 1 << 20;
+        static constexpr int syncBatch = 32;
+
+        template <typename VisitT>
+        std::size_t validRecordsEnd(VisitT visit)
+        {
+            std::string_view file(mData, mCapacity);
+            if (file.substr(0, mMagic.size()) != mMagic)
+            {
+                return 0;
+            }
+            std::size_t offset = mMagic.size();
+            while (true)
+            {
+                ByteReader header(file.substr(offset));
+                std::uint32_t length = 0;
+                std::uint32_t checksum = 0;
+                if (not header.read(length) || not header.read(checksum) || length == 0 ||
+                    header.remaining() < length)
+                {
+                    return offset;
+                }
+                std::string_view payload = file.substr(offset + 2 * sizeof(std::uint32_t), length);
+                if (crc32(payload) != checksum)
+                {
+                    return offset;
+                }
+                visit(payload);
+                offset += 2 * sizeof(std::uint32_t) + length;
+            }
+        }
+
+        // A file that was not closed still holds the zero padding that
+        // reserve added, which is not part of any record.
+        std::size_t recordedBytesAfter(std::size_t offset) const
+        {
+            std::size_t end = mCapacity;
+            while (end > offset && mData[end - 1] == 0)
+            {
+                --end;
+            }
+            return end - offset;
+        }
+
+#if defined(__linux__)
+        bool map(std::size_t capacity)
+        {
+            void *data = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, mFd, 0);
+            if (data == MAP_FAILED)
+            {
+                return false;
+            }
+            mData = static_cast<char *>(data);
+            mCapacity = capacity;
+            return true;
+        }
+
+        bool reserve(std::size_t size)
+        {
+            if (size <= mCapacity)
+            {
+                return true;
+            }
+            std::size_t capacity = (size / growBy + 1) * growBy;
+            if (mData != nullptr)
+            {
+                sync();
+                munmap(mData, mCapacity);
+                mData = nullptr;
+                mCapacity = 0;
+            }
+            return ftruncate(mFd, static_cast<off_t>(capacity)) == 0 && map(capacity);
+        }
+#endif
+
+        int mFd = -1;
+        char *mData = nullptr;
+        std::size_t mCapacity = 0;
+        std::size_t mSize = 0;
+        std::size_t mDiscarded = 0;
+        int mUnsynced = 0;
+        std::string_view mMagic;
+    };
+
+    struct JournalEntry
+    {
+        TestOutcome outcome;
+        std::int64_t durationNs;
+        int confirmLocation;
+        std::string reason;
+    };
+
+    inline std::string testKey(std::string_view suiteName, std::string_view name)
+    {
+        std::string key(suiteName);
+        key += '\n';
+        key += name;
+        return key;
+    }
+
+    // Results of completed tests, kept so an interrupted run can resume.
+    class Journal
+    {
+    public:
+        bool open(std::string const &path, bool resume)
+        {
+            mEntries.clear();
+            return mFile.open(path, "TDDJRNL1", resume, [this](std::string_view payload)
+            {
+                readEntry(payload);
+            });
+        }
+
+        void close()
+        {
+            mFile.close();
+        }
+
+        bool isOpen() const { return mFile.isOpen(); }
+
+        std::size_t discarded() const { return mFile.discarded(); }
+
+        std::size_t size() const { return mEntries.size(); }
+
+        JournalEntry const *find(const TestBase *test) const
+        {
+            auto found = mEntries.find(testKey(test->suiteName(), test->name()));
+            return found == mEntries.end() ? nullptr : &found->second;
+        }
+
+        void append(const TestBase *test, TestOutcome outcome)
+        {
+            mBuffer.clear();
+            appendValue(mBuffer, static_cast<std::uint8_t>(outcome));
+            appendValue(mBuffer, static_cast<std::int64_t>(test->duration().count()));
+            appendValue(mBuffer, static_cast<std::int32_t>(test->confirmLocation()));
+            appendText(mBuffer, test->suiteName());
+            appendText(mBuffer, test->name());
+            appendText(mBuffer, test->reason());
+            mFile.append(mBuffer);
+        }
+
+    private:
+        void readEntry(std::string_view payload)
+        {
+            ByteReader reader(payload);
+            std::uint8_t outcome = 0;
+            std::int64_t durationNs = 0;
+            std::int32_t confirmLocation = 0;
+            std::string_view suiteName;
+            std::string_view name;
+            std::string_view reason;
+            if (reader.read(outcome) && reader.read(durationNs) && reader.read(confirmLocation) &&
+                reader.readText(suiteName) && reader.readText(name) && reader.readText(reason))
+            {
+                mEntries[testKey(suiteName, name)] = {
+                    static_cast<TestOutcome>(outcome), durationNs, confirmLocation, std::string(reason)};
+            }
+        }
+
+        RecordFile mFile;
+        std::map<std::string, JournalEntry> mEntries;
+        std::string mBuffer;
+    };
+
+    // Results of every run, appended to a RecordFile so they can be queried
+    // for trends. Three kinds of record keep the rows compact:
+    //   run:  the run number and when it started
+    //   name: a suite and test name, stored once and then referred to by id
+    //   row:  one test result in the current run
+    class History
+    {
+    public:
+        struct Row
+        {
+            std::uint32_t run;
+            TestOutcome outcome;
+            std::int64_t durationNs;
+            ResourceCounters counters;
+        };
+
+        struct TestHistory
+        {
+            std::string suiteName;
+            std::string name;
+            std::vector<Row> rows; // oldest first
+        };
+
+        bool open(std::string const &path)
+        {
+            mTests.clear();
+            mIndex.clear();
+            mRun = 0;
+            return mFile.open(path, "TDDHIST1", true, [this](std::string_view payload)
+            {
+                readRecord(payload);
+            });
+        }
+
+        void close()
+        {
+            mFile.close();
+        }
+
+        bool isOpen() const { return mFile.isOpen(); }
+
+        // Starts a new run. Rows appended afterwards belong to it.
+        void beginRun()
+        {
+            ++mRun;
+            mBuffer.clear();
+            appendValue(mBuffer, RecordKind::run);
+            appendValue(mBuffer, mRun);
+            appendValue(mBuffer, static_cast<std::int64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                                               std::chrono::system_clock::now().time_since_epoch())
+                                                               .count()));
+            mFile.append(mBuffer);
+        }
+
+        void append(const TestBase *test, TestOutcome outcome)
+        {
+            std::uint32_t id = nameId(test->suiteName(), test->name());
+            Row row{mRun, outcome, static_cast<std::int64_t>(test->duration().count()), test->counters()};
+            mTests[id].rows.push_back(row);
+
+            mBuffer.clear();
+            appendValue(mBuffer, RecordKind::row);
+            appendValue(mBuffer, row.run);
+            appendValue(mBuffer, id);
+            appendValue(mBuffer, static_cast<std::uint8_t>(row.outcome));
+            appendValue(mBuffer, row.durationNs);
+            appendValue(mBuffer, static_cast<std::uint8_t>(row.counters.sampled));
+            if (row.counters.sampled)
+            {
+                for (std::int64_t value : counterValues(row.counters))
+                {
+                    appendValue(mBuffer, value);
+                }
+            }
+            mFile.append(mBuffer);
+        }
+
+        std::uint32_t runs() const { return mRun; }
+
+        std::vector<TestHistory> const &tests() const { return mTests; }
+
+        TestHistory const *find(std::string_view suiteName, std::string_view name) const
+        {
+            auto found = mIndex.find(testKey(suiteName, name));
+            return found == mIndex.end() ? nullptr : &mTests[found->second];
+        }
+
+    private:
+        enum class RecordKind : std::uint8_t
+        {
+            run,
+            name,
+            row
+        };
+
+        static std::array<std::int64_t, 7> counterValues(ResourceCounters const &counters)
+        {
+            return {counters.cycles, counters.instructions, counters.cacheMisses, counters.branchMisses,
+                    counters.pageFaults, counters.contextSwitches, counters.maxRssKb};
+        }
+
+        std::uint32_t nameId(std::string_view suiteName, std::string_view name)
+        {
+            auto [found, added] = mIndex.try_emplace(testKey(suiteName, name), static_cast<std::uint32_t>(mTests.size()));
+            if (added)
+            {
+                mTests.push_back({std::string(suiteName), std::string(name), {}});
+                mBuffer.clear();
+                appendValue(mBuffer, RecordKind::name);
+                appendValue(mBuffer, found->second);
+                appendText(mBuffer, suiteName);
+                appendText(mBuffer, name);
+                mFile.append(mBuffer);
+            }
+            return found->second;
+        }
+
+        void readRecord(std::string_view payload)
+        {
+            ByteReader reader(payload);
+            RecordKind kind{};
+            if (not reader.read(kind))
+            {
+                return;
+            }
+            if (kind == RecordKind::run)
+            {
+                reader.read(mRun);
+            }
+            else if (kind == RecordKind::name)
+            {
+                readName(reader);
+            }
+            else if (kind == RecordKind::row)
+            {
+                readRow(reader);
+            }
+        }
+
+        void readName(ByteReader &reader)
+        {
+            std::uint32_t id = 0;
+            std::string_view suiteName;
+            std::string_view name;
+            if (reader.read(id) && reader.readText(suiteName) && reader.readText(name) && id == mTests.size())
+            {
+                mIndex.emplace(testKey(suiteName, name), id);
+                mTests.push_back({std::string(suiteName), std::string(name), {}});
+            }
+        }
+
+        void readRow(ByteReader &reader)
+        {
+            Row row{};
+            std::uint32_t id = 0;
+            std::uint8_t outcome = 0;
+            std::uint8_t sampled = 0;
+            if (not reader.read(row.run) || not reader.read(id) || not reader.read(outcome) ||
+                not reader.read(row.durationNs) || not reader.read(sampled) || id >= mTests.size())
+            {
+                return;
+            }
+            row.outcome = static_cast<TestOutcome>(outcome);
+            if (sampled != 0)
+            {
+                row.counters.sampled = true;
+                std::int64_t *values[] = {
+                    &row.counters.cycles, &row.counters.instructions, &row.counters.cacheMisses,
+                    &row.counters.branchMisses, &row.counters.pageFaults, &row.counters.contextSwitches,
+                    &row.counters.maxRssKb};
+                for (auto *value : values)
+                {
+                    reader.read(*value);
+                }
+            }
+            mTests[id].rows.push_back(row);
+        }
+
+        RecordFile mFile;
+        std::vector<TestHistory> mTests;
+        std::unordered_map<std::string, std::uint32_t> mIndex;
+        std::uint32_t mRun = 0;
+        std::string mBuffer;
+    };
+
+    inline bool isFailedOutcome(TestOutcome outcome)
+    {
+        return outcome == TestOutcome::Failed || outcome == TestOutcome::MissedFailure ||
+               outcome == TestOutcome::Quarantined;
+    }
+
+    inline std::string_view outcomeName(TestOutcome outcome)
+    {
+        switch (outcome)
+        {
+        case TestOutcome::Passed:
+            return "Passed";
+        case TestOutcome::Failed:
+            return "Failed";
+        case TestOutcome::ExpectedFailure:
+            return "Expected failure";
+        case TestOutcome::MissedFailure:
+            return "Missed expected failure";
+        case TestOutcome::Quarantined:
+            return "Quarantined failure";
+        }
+        return "Unknown";
+    }
+
+    // Answers --history: the timing trend of every test whose name contains
+    // query over the last runs, then the tests whose duration grew most.
+    class HistoryReport
+    {
+    public:
+        HistoryReport(History const &history, std::uint32_t runs)
+            : mHistory(history),
+              mFirstRun(history.runs() > runs ? history.runs() - runs + 1 : 1) {}
+
+        // Tests that did not run in the window are left out.
+        void printTrend(std::string_view query) const
+        {
+            for (auto const &test : mHistory.tests())
+            {
+                auto rows = recentRows(test);
+                if (test.name.find(query) == std::string::npos || rows.empty())
+                {
+                    continue;
+                }
+                *outStream << "------------ History: " << displayName(test) << std::endl;
+                for (auto const &row : rows)
+                {
+                    *outStream << "    Run " << row.run << ": "
+                               << formatDuration(std::chrono::nanoseconds(row.durationNs)) << "  "
+                               << outcomeName(row.outcome) << std::endl;
+                }
+            }
+        }
+
+        // Growth compares the newest duration with the mean of the earlier
+        // runs in the window.
+        void printLargestGrowth(std::size_t count) const
+        {
+            struct Growth
+            {
+                History::TestHistory const *test;
+                double ratio;
+                std::int64_t beforeNs;
+                std::int64_t latestNs;
+            };
+            std::vector<Growth> growth;
+            for (auto const &test : mHistory.tests())
+            {
+                auto rows = recentRows(test);
+                if (rows.size() < 2)
+                {
+                    continue;
+                }
+                double before = 0.0;
+                for (std::size_t i = 0; i + 1 < rows.size(); ++i)
+                {
+                    before += static_cast<double>(rows[i].durationNs);
+                }
+                before /= static_cast<double>(rows.size() - 1);
+                std::int64_t latest = rows.back().durationNs;
+                growth.push_back({&test, static_cast<double>(latest) / std::max(before, 1.0),
+                                  static_cast<std::int64_t>(before), latest});
+            }
+            std::sort(growth.begin(), growth.end(), [](Growth const &a, Growth const &b)
+            {
+                return a.ratio > b.ratio;
+            });
+
+            *outStream << "------------ Largest duration growth" << std::endl;
+            for (std::size_t i = 0; i < growth.size() && i < count; ++i)
+            {
+                auto rows = recentRows(*growth[i].test);
+                auto failures = std::count_if(rows.begin(), rows.end(), [](History::Row const &row)
+                {
+                    return isFailedOutcome(row.outcome);
+                });
+                auto percent = static_cast<std::int64_t>((growth[i].ratio - 1.0) * 100.0);
+                *outStream << "    " << (percent >= 0 ? "+" : "") << percent << "%  "
+                           << displayName(*growth[i].test) << " ("
+                           << formatDuration(std::chrono::nanoseconds(growth[i].beforeNs)) << " -> "
+                           << formatDuration(std::chrono::nanoseconds(growth[i].latestNs)) << "), failed "
+                           << failures << " of " << rows.size() << " runs" << std::endl;
+            }
+        }
+
+    private:
+        // Tests in different suites may share a name.
+        static std::string displayName(History::TestHistory const &test)
+        {
+            return test.suiteName.empty() ? test.name : test.suiteName + "/" + test.name;
+        }
+
+        std::span<History::Row const> recentRows(History::TestHistory const &test) const
+        {
+            auto first = std::lower_bound(test.rows.begin(), test.rows.end(), mFirstRun,
+                                          [](History::Row const &row, std::uint32_t run)
+                                          {
+                                              return row.run < run;
+                                          });
+            return {first, test.rows.end()};
+        }
+
+        History const &mHistory;
+        std::uint32_t mFirstRun;
+    };
+
+#if defined(TDD_COVERAGE)
+    // Entry points of the gcov runtime. Define TDD_COVERAGE in builds made
+    // with --coverage to record coverage maps. The references must be
+    // strong, since a weak reference does not pull them out of libgcov.
+    extern "C" void __gcov_dump();
+    extern "C" void __gcov_reset();
+#endif
+
+    // Indexes into the function table of a CoverageMap.
+    using CoverageSet = std::set<std::uint32_t>;
+
+    struct CoveredFunction
+    {
+        std::string file;
+        std::string name;
+    };
+
+    constexpr std::uint32_t gcovNotesMagic = 0x67636e6f;   // "gcno"
+    constexpr std::uint32_t gcovDataMagic = 0x67636461;    // "gcda"
+    constexpr std::uint32_t gcovFunctionTag = 0x01000000;
+    constexpr std::uint32_t gcovArcCountsTag = 0x01a10000;
+
+    // Reads the gcov header shared by notes and data files. Only the format
+    // written by GCC 12 and later is understood: record lengths in bytes and
+    // strings without padding.
+    inline bool readGcovHeader(ByteReader &reader, std::uint32_t magic)
+    {
+        std::uint32_t fileMagic = 0;
+        std::uint32_t version = 0;
+        std::uint32_t stamp = 0;
+        std::uint32_t checksum = 0;
+        if (not reader.read(fileMagic) || not reader.read(version) || not reader.read(stamp) ||
+            not reader.read(checksum) || fileMagic != magic)
+        {
+            return false;
+        }
+        // The version spells the compiler release, such as "B22*" for 12.2.
+        int major = static_cast<int>((version >> 24) - 'A') * 10 + static_cast<int>(((version >> 16) & 0xff) - '0');
+        return major >= 12;
+    }
+
+    inline bool readGcovString(ByteReader &reader, std::string_view &text)
+    {
+        if (not reader.readText(text))
+        {
+            return false;
+        }
+        if (not text.empty() && text.back() == '\0')
+        {
+            text.remove_suffix(1);
+        }
+        return true;
+    }
+
+    // Maps the function identifiers of one object file to the source file
+    // and mangled name recorded in its .gcno notes.
+    inline std::unordered_map<std::uint32_t, CoveredFunction> readCoverageNotes(std::string_view data)
+    {
+        std::unordered_map<std::uint32_t, CoveredFunction> functions;
+        ByteReader reader(data);
+        std::string_view directory;
+        std::uint32_t unexecutedBlocks = 0;
+        if (not readGcovHeader(reader, gcovNotesMagic) || not readGcovString(reader, directory) ||
+            not reader.read(unexecutedBlocks))
+        {
+            return functions;
+        }
+
+        std::uint32_t tag = 0;
+        std::uint32_t length = 0;
+        while (reader.read(tag) && reader.read(length) && reader.remaining() >= length)
+        {
+            ByteReader record(reader.take(length));
+            std::uint32_t ident = 0;
+            std::uint32_t checksums[2] = {};
+            std::uint32_t artificial = 0;
+            std::string_view name;
+            std::string_view file;
+            if (tag == gcovFunctionTag && record.read(ident) && record.read(checksums) &&
+                readGcovString(record, name) && record.read(artificial) && readGcovString(record, file))
+            {
+                std::filesystem::path path = std::filesystem::path(directory) / file;
+                functions[ident] = {path.lexically_normal().string(), std::string(name)};
+            }
+        }
+        return functions;
+    }
+
+    // Identifiers of the functions in one .gcda data file whose arc counters
+    // are not all zero. GCC writes an all-zero counter record with a negative
+    // length and no data.
+    inline std::vector<std::uint32_t> readExecutedFunctions(std::string_view data)
+    {
+        std::vector<std::uint32_t> executed;
+        ByteReader reader(data);
+        if (not readGcovHeader(reader, gcovDataMagic))
+        {
+            return executed;
+        }
+
+        std::uint32_t ident = 0;
+        std::uint32_t tag = 0;
+        std::int32_t length = 0;
+        while (reader.read(tag) && reader.read(length))
+        {
+            if (length < 0)
+            {
+                continue;
+            }
+            if (reader.remaining() < static_cast<std::size_t>(length))
+            {
+                break;
+            }
+            ByteReader record(reader.take(static_cast<std::size_t>(length)));
+            if (tag == gcovFunctionTag)
+            {
+                record.read(ident);
+            }
+            else if (tag == gcovArcCountsTag)
+            {
+                std::uint64_t count = 0;
+                while (record.read(count) && count == 0)
+                {
+                }
+                if (count != 0)
+                {
+                    executed.push_back(ident);
+                }
+            }
+        }
+        return executed;
+    }
+
+    inline std::string readWholeFile(std::filesystem::path const &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    // True when the trailing components of path equal suffix, so the
+    // repository relative names git prints match the absolute names the
+    // compiler records.
+    inline bool pathEndsWith(std::filesystem::path const &path, std::filesystem::path const &suffix)
+    {
+        auto pathPart = std::distance(path.begin(), path.end());
+        auto suffixPart = std::distance(suffix.begin(), suffix.end());
+        if (suffixPart == 0 || suffixPart > pathPart)
+        {
+            return false;
+        }
+        auto start = std::next(path.begin(), pathPart - suffixPart);
+        return std::equal(start, path.end(), suffix.begin());
+    }
+
+    // The functions each test executed, with the source file that defines
+    // them. Coverage of a suite setup counts for every test in the suite, so
+    // changes to a fixture select the tests that need it. The map is a text
+    // file of tab separated lines. Function lines come first and are numbered
+    // from 0, then each test lists the numbers of the functions it executed:
+    //     function<TAB>source path<TAB>mangled name
+    //     test<TAB>suite<TAB>test name<TAB>0 4 17
+    class CoverageMap
+    {
+    public:
+        std::uint32_t intern(CoveredFunction const &function)
+        {
+            auto [found, added] = mIndex.try_emplace({function.file, function.name},
+                                                     static_cast<std::uint32_t>(mFunctions.size()));
+            if (added)
+            {
+                mFunctions.push_back(function);
+            }
+            return found->second;
+        }
+
+        void beginSuite()
+        {
+            mSuiteCoverage.clear();
+            mAsyncCoverage.clear();
+        }
+
+        CoverageSet &suiteCoverage() { return mSuiteCoverage; }
+
+        // Async tests of a suite run interleaved, so they share one coverage.
+        CoverageSet &asyncCoverage() { return mAsyncCoverage; }
+
+        // Replaces whatever coverage the test had in a map read earlier.
+        void add(std::string_view suiteName, std::string_view name, CoverageSet const &coverage)
+        {
+            CoverageSet &tested = mTests[{std::string(suiteName), std::string(name)}];
+            tested = mSuiteCoverage;
+            tested.insert(coverage.begin(), coverage.end());
+        }
+
+        std::size_t size() const { return mTests.size(); }
+
+        std::vector<CoveredFunction> const &functions() const { return mFunctions; }
+
+        CoverageSet const *find(std::string_view suiteName, std::string_view name) const
+        {
+            auto found = mTests.find({std::string(suiteName), std::string(name)});
+            return found == mTests.end() ? nullptr : &found->second;
+        }
+
+        bool write(std::string const &path) const
+        {
+            std::ofstream file(path);
+            for (auto const &function : mFunctions)
+            {
+                file << "function\t" << function.file << '\t' << function.name << '\n';
+            }
+            for (auto const &[test, coverage] : mTests)
+            {
+                file << "test\t" << test.first << '\t' << test.second << '\t';
+                char const *separator = "";
+                for (auto index : coverage)
+                {
+                    file << separator << index;
+                    separator = " ";
+                }
+                file << '\n';
+            }
+            return static_cast<bool>(file.flush());
+        }
+
+        bool read(std::string const &path)
+        {
+            std::ifstream file(path);
+            if (not file.is_open())
+            {
+                return false;
+            }
+            std::string line;
+            while (std::getline(file, line))
+            {
+                std::vector<std::string_view> fields;
+                std::string_view text = line;
+                for (std::size_t tab = text.find('\t'); tab != std::string_view::npos; tab = text.find('\t'))
+                {
+                    fields.push_back(text.substr(0, tab));
+                    text.remove_prefix(tab + 1);
+                }
+                fields.push_back(text);
+
+                if (fields.size() == 3 && fields[0] == "function")
+                {
+                    intern({std::string(fields[1]), std::string(fields[2])});
+                }
+                else if (fields.size() == 4 && fields[0] == "test")
+                {
+                    CoverageSet &coverage = mTests[{std::string(fields[1]), std::string(fields[2])}];
+                    std::istringstream indexes{std::string(fields[3])};
+                    std::uint32_t index = 0;
+                    while (indexes >> index)
+                    {
+                        if (index < mFunctions.size())
+                        {
+                            coverage.insert(index);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Flags every function defined in one of the changed files.
+        std::vector<bool> changedFunctions(std::vector<std::filesystem::path> const &changedFiles) const
+        {
+            std::map<std::string_view, bool> changedByFile;
+            std::vector<bool> changed;
+            changed.reserve(mFunctions.size());
+            for (auto const &function : mFunctions)
+            {
+                auto [found, added] = changedByFile.try_emplace(function.file, false);
+                if (added)
+                {
+                    std::filesystem::path source(function.file);
+                    found->second = std::any_of(changedFiles.begin(), changedFiles.end(),
+                                                [&source](auto const &file) { return pathEndsWith(source, file); });
+                }
+                changed.push_back(found->second);
+            }
+            return changed;
+        }
+
+        // Tests missing from the map have never been recorded, so they are
+        // treated as affected by any change.
+        bool isAffected(std::string_view suiteName, std::string_view name, std::vector<bool> const &changedFunctions) const
+        {
+            CoverageSet const *coverage = find(suiteName, name);
+            if (coverage == nullptr)
+            {
+                return true;
+            }
+            return std::any_of(coverage->begin(), coverage->end(),
+                               [&changedFunctions](std::uint32_t index) { return changedFunctions[index]; });
+        }
+
+    private:
+        std::vector<CoveredFunction> mFunctions;
+        std::map<std::pair<std::string, std::string>, std::uint32_t> mIndex;
+        std::map<std::pair<std::string, std::string>, CoverageSet> mTests;
+        CoverageSet mSuiteCoverage;
+        CoverageSet mAsyncCoverage;
+    };
+
+    // Collects per-test coverage from a --coverage build. The counters are
+    // reset before a test runs and dumped after it, so each dump holds only
+    // that test's coverage. Every .gcda file under the directory is read and
+    // then removed, which also discards coverage left by earlier runs.
+    class CoverageRecorder
+    {
+    public:
+        static bool isInstrumented()
+        {
+#if defined(TDD_COVERAGE)
+            return true;
+#else
+            return false;
+#endif
+        }
+
+        bool open(std::filesystem::path const &directory)
+        {
+            if (not isInstrumented() || not std::filesystem::is_directory(directory))
+            {
+                return false;
+            }
+            mDirectory = directory;
+            mOpen = true;
+            for (auto const &path : dataFiles())
+            {
+                std::filesystem::remove(path);
+            }
+            return true;
+        }
+
+        bool isOpen() const { return mOpen; }
+
+        void begin()
+        {
+#if defined(TDD_COVERAGE)
+            if (mOpen)
+            {
+                __gcov_reset();
+            }
+#endif
+        }
+
+        void collect(CoverageMap &map, CoverageSet &coverage)
+        {
+#if defined(TDD_COVERAGE)
+            if (not mOpen)
+            {
+                return;
+            }
+            __gcov_dump();
+            for (auto const &path : dataFiles())
+            {
+                auto const &notes = notesFor(path);
+                for (auto ident : readExecutedFunctions(readWholeFile(path)))
+                {
+                    if (auto found = notes.find(ident); found != notes.end())
+                    {
+                        coverage.insert(map.intern(found->second));
+                    }
+                }
+                std::filesystem::remove(path);
+            }
+#else
+            (void)map;
+            (void)coverage;
+#endif
+        }
+
+    private:
+        std::vector<std::filesystem::path> dataFiles() const
+        {
+            std::vector<std::filesystem::path> files;
+            std::error_code error;
+            for (auto const &entry : std::filesystem::recursive_directory_iterator(mDirectory, error))
+            {
+                if (entry.is_regular_file() && entry.path().extension() == ".gcda")
+                {
+                    files.push_back(entry.path());
+                }
+            }
+            return files;
+        }
+
+        // The compiler writes the notes next to the data file.
+        std::unordered_map<std::uint32_t, CoveredFunction> const &notesFor(std::filesystem::path dataPath)
+        {
+            std::string notesPath = dataPath.replace_extension(".gcno").string();
+            auto found = mNotes.find(notesPath);
+            if (found == mNotes.end())
+            {
+                found = mNotes.emplace(notesPath, readCoverageNotes(readWholeFile(notesPath))).first;
+            }
+            return found->second;
+        }
+
+        std::filesystem::path mDirectory;
+        std::map<std::string, std::unordered_map<std::uint32_t, CoveredFunction>> mNotes;
+        bool mOpen = false;
+    };
+
+    // Live status line for terminals showing tests done out of the total,
+    // pass and fail counts, throughput, time left and the running test.
+    // The runner only updates relaxed atomics. A renderer thread redraws the
+    // line ten times a second, and output written while the display is
+    // active goes through stream() so each line clears the status first and
+    // the status stays below the scrolling output.
+    class ProgressDisplay
+    {
+    public:
+        ProgressDisplay() = default;
+        ProgressDisplay(ProgressDisplay const &) = delete;
+        ProgressDisplay &operator=(ProgressDisplay const &) = delete;
+
+        ~ProgressDisplay()
+        {
+            stop();
+        }
+
+        static bool isTerminal(std::ostream const &os)
+        {
+#if defined(__linux__)
+            char const *term = std::getenv("TERM");
+            if (term != nullptr && std::string_view(term) == "dumb")
+            {
+                return false;
+            }
+            if (&os == &std::cout)
+            {
+                return isatty(STDOUT_FILENO) == 1;
+            }
+            if (&os == &std::cerr || &os == &std::clog)
+            {
+                return isatty(STDERR_FILENO) == 1;
+            }
+#else
+            (void)os;
+#endif
+            return false;
+        }
+
+        // estimateNs is the expected time of the tests with a known duration,
+        // and the remaining ones are estimated from the tests finished so far.
+        void start(std::ostream &terminal, int total, std::int64_t estimateNs, int unestimated)
+        {
+            stop();
+            mTerminal = &terminal;
+            mTotal = total;
+            mDone = 0;
+            mPassed = 0;
+            mFailed = 0;
+            mMissedFailures = 0;
+            mQuarantined = 0;
+            mRemainingEstimateNs = estimateNs;
+            mUnestimated = unestimated;
+            mMeasured = 0;
+            mMeasuredNs = 0;
+            mCurrent = nullptr;
+            mStart = std::chrono::steady_clock::now();
+            mBuffer.emplace(*this);
+            mStream.emplace(&*mBuffer);
+            draw();
+            mRenderer = std::jthread([this](std::stop_token token)
+                                     {
+                                         render(token);
+                                     });
+        }
+
+        void stop()
+        {
+            if (not mRenderer.joinable())
+            {
+                return;
+            }
+            mRenderer.request_stop();
+            mRenderer.join();
+            *mTerminal << "\r\x1b[K" << std::flush;
+            mStream->flush();
+            mBuffer->flushPending();
+            mStream.reset();
+            mBuffer.reset();
+        }
+
+        bool isActive() const { return mRenderer.joinable(); }
+
+        std::ostream &stream() { return *mStream; }
+
+        std::ostream &terminal() { return *mTerminal; }
+
+        void testStarted(const TestBase *test)
+        {
+            mCurrentStartNs.store(elapsedNs(), std::memory_order_relaxed);
+            mCurrent.store(test, std::memory_order_relaxed);
+        }
+
+        // estimateNs is -1 for a test without a known duration. durationNs
+        // is -1 unless the test ran before it was started, as async tests
+        // interleaved on the event loop do. Outcomes are counted the same
+        // way as in the summary printed after the run.
+        void testFinished(TestOutcome outcome, std::int64_t estimateNs, std::int64_t durationNs = -1)
+        {
+            mCurrent.store(nullptr, std::memory_order_relaxed);
+            if (estimateNs < 0)
+            {
+                if (durationNs < 0)
+                {
+                    durationNs = elapsedNs() - mCurrentStartNs.load(std::memory_order_relaxed);
+                }
+                mMeasuredNs.fetch_add(durationNs, std::memory_order_relaxed);
+                mMeasured.fetch_add(1, std::memory_order_relaxed);
+                mUnestimated.fetch_sub(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                mRemainingEstimateNs.fetch_sub(estimateNs, std::memory_order_relaxed);
+            }
+            counterOf(outcome).fetch_add(1, std::memory_order_relaxed);
+            mDone.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        std::string statusLine() const
+        {
+            int done = mDone.load(std::memory_order_relaxed);
+            std::int64_t elapsed = elapsedNs();
+            std::ostringstream os;
+            os << '[' << done << '/' << mTotal << "] "
+               << mPassed.load(std::memory_order_relaxed) << " passed, "
+               << mFailed.load(std::memory_order_relaxed) << " failed";
+            if (int missed = mMissedFailures.load(std::memory_order_relaxed); missed != 0)
+            {
+                os << ", " << missed << " missed";
+            }
+            if (int quarantined = mQuarantined.load(std::memory_order_relaxed); quarantined != 0)
+            {
+                os << ", " << quarantined << " quarantined";
+            }
+            if (elapsed > 0)
+            {
+                os << " | " << static_cast<std::int64_t>(done * 1e9 / static_cast<double>(elapsed)) << " tests/s";
+            }
+
+            std::int64_t remaining = mRemainingEstimateNs.load(std::memory_order_relaxed);
+            int unestimated = mUnestimated.load(std::memory_order_relaxed);
+            int measured = mMeasured.load(std::memory_order_relaxed);
+            if (unestimated != 0 && done == 0)
+            {
+                os << " | ETA --";
+            }
+            else
+            {
+                // Tests without history take the mean of those measured so
+                // far, or of every finished test before any was measured.
+                if (unestimated != 0)
+                {
+                    std::int64_t mean = measured != 0 ? mMeasuredNs.load(std::memory_order_relaxed) / measured
+                                                      : elapsed / done;
+                    remaining += mean * unestimated;
+                }
+                if (mCurrent.load(std::memory_order_relaxed) != nullptr)
+                {
+                    remaining -= elapsed - mCurrentStartNs.load(std::memory_order_relaxed);
+                }
+                os << " | ETA " << formatDuration(std::chrono::nanoseconds(std::max<std::int64_t>(remaining, 0)));
+            }
+            if (const TestBase *current = mCurrent.load(std::memory_order_relaxed))
+            {
+                os << " | " << current->name();
+            }
+            std::string status = os.str();
+            std::size_t width = terminalWidth();
+            if (status.size() >= width)
+            {
+                status.resize(width - 1);
+            }
+            return status;
+        }
+
+    private:
+        // Writes whole lines to the terminal, clearing the status line first.
+        class LineBuffer : public std::streambuf
+        {
+        public:
+            explicit LineBuffer(ProgressDisplay &display) : mDisplay(display) {}
+
+            void flushPending()
+            {
+                if (not mPending.empty())
+                {
+                    std::lock_guard lock(mDisplay.mMutex);
+                    *mDisplay.mTerminal << "\r\x1b[K" << mPending << std::flush;
+                    mPending.clear();
+                }
+            }
+
+        protected:
+            int_type overflow(int_type c) override
+            {
+                if (not traits_type::eq_int_type(c, traits_type::eof()))
+                {
+                    char ch = traits_type::to_char_type(c);
+                    xsputn(&ch, 1);
+                }
+                return traits_type::not_eof(c);
+            }
+
+            std::streamsize xsputn(char const *text, std::streamsize count) override
+            {
+                mPending.append(text, static_cast<std::size_t>(count));
+                std::size_t end = mPending.rfind('\n');
+                if (end != std::string::npos)
+                {
+                    std::lock_guard lock(mDisplay.mMutex);
+                    *mDisplay.mTerminal << "\r\x1b[K";
+                    mDisplay.mTerminal->write(mPending.data(), static_cast<std::streamsize>(end + 1));
+                    mDisplay.mTerminal->flush();
+                    mPending.erase(0, end + 1);
+                }
+                return count;
+            }
+
+        private:
+            ProgressDisplay &mDisplay;
+            std::string mPending;
+        };
+
+        std::int64_t elapsedNs() const
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - mStart)
+                .count();
+        }
+
+        void render(std::stop_token token)
+        {
+            std::mutex waitMutex;
+            std::condition_variable_any wake;
+            std::unique_lock waitLock(waitMutex);
+            while (not wake.wait_for(waitLock, token, std::chrono::milliseconds(100), [] { return false; }) &&
+                   not token.stop_requested())
+            {
+                draw();
+            }
+        }
+
+        void draw()
+        {
+            std::string status = statusLine();
+            std::lock_guard lock(mMutex);
+            *mTerminal << "\r\x1b[K" << status << std::flush;
+        }
+
+        std::atomic<int> &counterOf(TestOutcome outcome)
+        {
+            switch (outcome)
+            {
+            case TestOutcome::Failed:
+                return mFailed;
+            case TestOutcome::MissedFailure:
+                return mMissedFailures;
+            case TestOutcome::Quarantined:
+                return mQuarantined;
+            case TestOutcome::Passed:
+            case TestOutcome::ExpectedFailure:
+                break;
+            }
+            return mPassed;
+        }
+
+        std::size_t terminalWidth() const
+        {
+#if defined(__linux__)
+            winsize size{};
+            int fd = mTerminal == &std::cout ? STDOUT_FILENO : STDERR_FILENO;
+            if (ioctl(fd, TIOCGWINSZ, &size) == 0 && size.ws_col > 1)
+            {
+                return size.ws_col;
+            }
+#endif
+            return 80;
+        }
+
+        std::ostream *mTerminal = nullptr;
+        std::mutex mMutex; // serializes writes to the terminal
+        std::optional<LineBuffer> mBuffer;
+        std::optional<std::ostream> mStream;
+        std::chrono::steady_clock::time_point mStart;
+        int mTotal = 0;
+        std::atomic<int> mDone = 0;
+        std::atomic<int> mPassed = 0;
+        std::atomic<int> mFailed = 0;
+        std::atomic<int> mMissedFailures = 0;
+        std::atomic<int> mQuarantined = 0;
+        std::atomic<std::int64_t> mRemainingEstimateNs = 0;
+        std::atomic<int> mUnestimated = 0; // tests left without a known duration
+        std::atomic<int> mMeasured = 0;
+        std::atomic<std::int64_t> mMeasuredNs = 0;
+        std::atomic<const TestBase *> mCurrent = nullptr;
+        std::atomic<std::int64_t> mCurrentStartNs = 0;
+        std::jthread mRenderer;
+    };
+
+    // Single threaded loop that interleaves the coroutines of async tests.
+    // Coroutines suspend on timers or on polled conditions such as futures,
+    // and the loop only sleeps when nothing is ready to resume.
+    class EventLoop
+    {
+    public:
+        void post(std::coroutine_handle<> handle)
+        {
+            mReady.push_back(handle);
+        }
+
+        void schedule(std::chrono::steady_clock::time_point when, std::coroutine_handle<> handle)
+        {
+            mTimers.push({when, mNextSequence++, handle});
+        }
+
+        void poll(std::function<bool()> isReady, std::coroutine_handle<> handle)
+        {
+            mPollers.push_back({std::move(isReady), handle});
+        }
+
+        bool idle() const
+        {
+            return mReady.empty() && mTimers.empty() && mPollers.empty();
+        }
+
+        void run()
+        {
+            runUntil([] { return false; });
+        }
+
+        // Runs until done returns true or there is nothing left to resume.
+        template <typename DoneT>
+        void runUntil(DoneT done)
+        {
+            while (not done() && not idle())
+            {
+                while (not mReady.empty() && not done())
+                {
+                    auto handle = mReady.front();
+                    mReady.pop_front();
+                    handle.resume();
+                }
+                collectPolled();
+                collectTimers();
+                if (mReady.empty() && not done())
+                {
+                    waitForWork();
+                }
+            }
+        }
+
+    private:
+        // Polled awaitables are checked at least this often while the loop waits.
+        static constexpr std::chrono::microseconds pollInterval{200};
+
+        struct Timer
+        {
+            std::chrono::steady_clock::time_point when;
+            std::uint64_t sequence; // keeps timers with equal deadlines in order
+            std::coroutine_handle<> handle;
+
+            bool operator>(Timer const &other) const
+            {
+                return when != other.when ? when > other.when : sequence > other.sequence;
+            }
+        };
+
+        struct Poller
+        {
+            std::function<bool()> isReady;
+            std::coroutine_handle<> handle;
+        };
+
+        void collectPolled()
+        {
+            for (std::size_t i = 0; i < mPollers.size();)
+            {
+                if (mPollers[i].isReady())
+                {
+                    mReady.push_back(mPollers[i].handle);
+                    mPollers[i] = std::move(mPollers.back());
+                    mPollers.pop_back();
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        void collectTimers()
+        {
+            auto now = std::chrono::steady_clock::now();
+            while (not mTimers.empty() && mTimers.top().when <= now)
+            {
+                mReady.push_back(mTimers.top().handle);
+                mTimers.pop();
+            }
+        }
+
+        void waitForWork()
+        {
+            if (mTimers.empty() && mPollers.empty())
+            {
+                return;
+            }
+            auto wakeUp = std::chrono::steady_clock::time_point::max();
+            if (not mTimers.empty())
+            {
+                wakeUp = mTimers.top().when;
+            }
+            if (not mPollers.empty())
+            {
+                wakeUp = std::min(wakeUp, std::chrono::steady_clock::now() + pollInterval);
+            }
+            std::this_thread::sleep_until(wakeUp);
+        }
+
+        std::deque<std::coroutine_handle<>> mReady;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> mTimers;
+        std::vector<Poller> mPollers;
+        std::uint64_t mNextSequence = 0;
+    };
+
+    template <typename T>
+    class FutureAwaiter
+    {
+    public:
+        explicit FutureAwaiter(std::future<T> &future) : mFuture(future) {}
+
+        bool await_ready() const
+        {
+            return isReady();
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            getEventLoop().poll([this] { return isReady(); }, handle);
+        }
+
+        T await_resume()
+        {
+            return mFuture.get();
+        }
+
+    private:
+        bool isReady() const
+        {
+            return mFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+
+        std::future<T> &mFuture;
+    };
+
+    // Coroutine type returned by async test bodies and by any helper
+    // coroutine they co_await. Exceptions, including failed confirms, are
+    // kept in the task and rethrown to whoever consumes its result.
+    class Task
+    {
+    public:
+        struct promise_type;
+        using Handle = std::coroutine_handle<promise_type>;
+
+        // Notes when the event loop first resumes the coroutine.
+        struct InitialAwaiter
+        {
+            promise_type &promise;
+
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+            void await_resume() const noexcept { promise.started = std::chrono::steady_clock::now(); }
+        };
+
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            std::coroutine_handle<> await_suspend(Handle handle) noexcept
+            {
+                handle.promise().finished = std::chrono::steady_clock::now();
+                auto continuation = handle.promise().continuation;
+                return continuation ? continuation : std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        struct promise_type
+        {
+            std::exception_ptr exception;
+            std::coroutine_handle<> continuation;
+            std::chrono::steady_clock::time_point started;
+            std::chrono::steady_clock::time_point finished;
+
+            Task get_return_object() { return Task(Handle::from_promise(*this)); }
+
+            InitialAwaiter initial_suspend() noexcept { return {*this}; }
+
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+
+            void return_void() const {}
+
+            void unhandled_exception() { exception = std::current_exception(); }
+
+            // Lets test bodies co_await a std::future directly.
+            template <typename T>
+            FutureAwaiter<T> await_transform(std::future<T> &future) { return FutureAwaiter<T>(future); }
+
+            template <typename T>
+            FutureAwaiter<T> await_transform(std::future<T> &&future) { return FutureAwaiter<T>(future); }
+
+            template <typename AwaitableT>
+            AwaitableT &&await_transform(AwaitableT &&awaitable) { return std::forward<AwaitableT>(awaitable); }
+        };
+
+        Task() = default;
+
+        Task(Task &&other) noexcept : mHandle(std::exchange(other.mHandle, nullptr)) {}
+
+        Task &operator=(Task &&other) noexcept
+        {
+            if (this != &other)
+            {
+                destroy();
+                mHandle = std::exchange(other.mHandle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task()
+        {
+            destroy();
+        }
+
+        bool valid() const { return static_cast<bool>(mHandle); }
+
+        bool done() const { return not mHandle || mHandle.done(); }
+
+        Handle handle() const { return mHandle; }
+
+        std::chrono::steady_clock::time_point startedAt() const { return mHandle.promise().started; }
+
+        std::chrono::steady_clock::time_point finishedAt() const { return mHandle.promise().finished; }
+
+        // Wall time from the first resume to completion, including the time
+        // the coroutine spent suspended while others ran.
+        std::chrono::nanoseconds duration() const
+        {
+            if (not mHandle || not mHandle.done())
+            {
+                return {};
+            }
+            return finishedAt() - startedAt();
+        }
+
+        void rethrowIfFailed() const
+        {
+            if (mHandle && mHandle.promise().exception)
+            {
+                std::rethrow_exception(mHandle.promise().exception);
+            }
+        }
+
+        // Awaiting a task starts it and resumes the caller once it finishes.
+        bool await_ready() const noexcept { return done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            mHandle.promise().continuation = awaiting;
+            return mHandle;
+        }
+
+        void await_resume() const { rethrowIfFailed(); }
+
+    private:
+        explicit Task(Handle handle) : mHandle(handle) {}
+
+        void destroy()
+        {
+            if (mHandle)
+            {
+                mHandle.destroy();
+                mHandle = nullptr;
+            }
+        }
+
+        Handle mHandle;
+    };
+
+    class SleepAwaiter
+    {
+    public:
+        explicit SleepAwaiter(std::chrono::steady_clock::time_point wakeUp) : mWakeUp(wakeUp) {}
+
+        bool await_ready() const { return std::chrono::steady_clock::now() >= mWakeUp; }
+
+        void await_suspend(std::coroutine_handle<> handle) const
+        {
+            getEventLoop().schedule(mWakeUp, handle);
+        }
+
+        void await_resume() const {}
+
+    private:
+        std::chrono::steady_clock::time_point mWakeUp;
+    };
+
+    // Suspends the awaiting coroutine without blocking the event loop.
+    template <typename Rep, typename Period>
+    SleepAwaiter sleepFor(std::chrono::duration<Rep, Period> duration)
+    {
+        return SleepAwaiter(std::chrono::steady_clock::now() + duration);
+    }
+
+    class AsyncTest : public Test
+    {
+    public:
+        AsyncTest(std::string_view name, std::string_view suiteName)
+            : Test(name, suiteName) {}
+
+        virtual Task runAsync() = 0;
+
+        // Queues the coroutine on the event loop so it can interleave with
+        // the other async tests started by the Runner.
+        void start()
+        {
+            mTask = runAsync();
+            getEventLoop().post(mTask.handle());
+        }
+
+        void run() override
+        {
+            if (not mTask.valid())
+            {
+                start();
+            }
+            getEventLoop().runUntil([this] { return mTask.done(); });
+
+            // The result is consumed here, so a repeated run starts a new coroutine.
+            Task task = std::move(mTask);
+            std::optional<ThreadConfirms::Capture> threadFailure = std::exchange(mThreadFailure, std::nullopt);
+            if (not task.done())
+            {
+                mTaskDuration = {};
+                throw std::runtime_error("Async test did not complete.");
+            }
+            mTaskDuration = task.duration();
+            getTracer().recordSpan(name(), "async", this, task.startedAt(), task.finishedAt());
+            task.rethrowIfFailed();
+            if (threadFailure)
+            {
+                setFailed(threadFailure->reason, threadFailure->line);
+            }
+        }
+
+        // Keeps a failure that another thread captured while the coroutine
+        // ran interleaved with the others, so run reports it later.
+        void claimThreadFailure()
+        {
+            if (mTask.valid() && mTask.done())
+            {
+                mThreadFailure = getThreadConfirms().firstBetween(mTask.startedAt(), mTask.finishedAt());
+            }
+        }
+
+        // The test's own time on the event loop, which the Runner reports
+        // instead of the time it took to collect an interleaved result.
+        std::chrono::nanoseconds taskDuration() const { return mTaskDuration; }
+
+    private:
+        Task mTask;
+        std::chrono::nanoseconds mTaskDuration{};
+        std::optional<ThreadConfirms::Capture> mThreadFailure;
+    };
+
+    // Totals printed in the summary after a run.
+    struct TestCounters
+    {
+        int passed = 0;
+        int failed = 0;
+        int missedFailures = 0;
+        int quarantined = 0;
+        int resumed = 0;
+        ResourceCounters resources;
+        std::vector<std::string_view> flaky;
+
+        // Expected failures count as passed. Missed expected failures and
+        // quarantined failures are listed apart from the failed tests.
+        void add(TestOutcome outcome)
+        {
+            switch (outcome)
+            {
+            case TestOutcome::Passed:
+            case TestOutcome::ExpectedFailure:
+                ++passed;
+                break;
+            case TestOutcome::Failed:
+                ++failed;
+                break;
+            case TestOutcome::MissedFailure:
+                ++missedFailures;
+                break;
+            case TestOutcome::Quarantined:
+                ++quarantined;
+                break;
+            }
+        }
+    };
+
+    // Outcome of running one test many times with --repeat or --until-fail.
+    struct RepeatStats
+    {
+        int runs = 0;
+        int succeeded = 0;
+        int firstFailure = 0; // 1-based, 0 when every run succeeded
+        double meanNs = 0.0;
+        double squaredDeviationNs = 0.0;
+
+        void addDuration(std::chrono::nanoseconds duration)
+        {
+            // Welford's online algorithm keeps the variance stable over many runs.
+            double value = static_cast<double>(duration.count());
+            double delta = value - meanNs;
+            meanNs += delta / runs;
+            squaredDeviationNs += delta * (value - meanNs);
+        }
+
+        double standardDeviationNs() const { return runs > 1 ? std::sqrt(squaredDeviationNs / (runs - 1)) : 0.0; }
+
+        bool flaky() const { return succeeded != 0 && succeeded != runs; }
+    };
+
+    // Parts of the Runner that are tested on their own.
+    namespace detail
+    {
+        inline bool isExpectedFailure(const Test *test)
+        {
+            return (not test->expectedReason().empty()) && test->expectedReason() == test->reason();
+        }
+
+        inline bool isMissedExpectedFailure(const Test *test)
+        {
+            return not test->expectedReason().empty();
+        }
+
+        inline bool isQuarantined(const Test *test)
+        {
+            return getRunOptions().quarantine.contains(test->name());
+        }
+
+        inline bool isSuccessfulRun(const Test *test)
+        {
+            return test->passed() ? test->expectedReason().empty() : isExpectedFailure(test);
+        }
+
+        // Whether --filter and --changed-files leave the test to run.
+        inline bool isSelected(const Test *test)
+        {
+            RunOptions const &options = getRunOptions();
+            if (not options.selected.empty() && not options.selected.contains(test))
+            {
+                return false;
+            }
+            return options.filter.empty() || test->name().find(options.filter) != std::string_view::npos;
+        }
+
+        // Whether the test still has to run, or --resume takes its result from the journal.
+        inline bool needsRun(const Test *test, const Journal &journal)
+        {
+            return isSelected(test) && (not getRunOptions().resume || journal.find(test) == nullptr);
+        }
+
+        // How the test's result is reported and counted.
+        inline TestOutcome outcomeOf(const Test *test)
+        {
+            if (test->passed())
+            {
+                return isMissedExpectedFailure(test) ? TestOutcome::MissedFailure : TestOutcome::Passed;
+            }
+            if (isExpectedFailure(test))
+            {
+                return TestOutcome::ExpectedFailure;
+            }
+            return isQuarantined(test) ? TestOutcome::Quarantined : TestOutcome::Failed;
+        }
+
+        // Tests hold their own result, so the runs of one test happen one
+        // after another. The reported result is the first unsuccessful run,
+        // or the last run when every run succeeded.
+        template <std::invocable<Test *> RunOnceT>
+        RepeatStats repeatTest(Test *test, RunOnceT runOnce)
+        {
+            RunOptions const &options = getRunOptions();
+            int limit = options.repeat > 1 ? options.repeat : RunOptions::untilFailLimit;
+            RepeatStats stats;
+            bool failed = false;
+            bool failedPassed = false;
+            std::string failedReason;
+            int failedLocation = -1;
+            ReasonArena::Mark mark = getReasonArena().mark();
+
+            while (stats.runs < limit)
+            {
+                if (stats.runs != 0)
+                {
+                    // The previous run's reasons were copied above when needed.
+                    test->setExpectedFailureReason({});
+                    getReasonArena().release(mark);
+                }
+                runOnce(test);
+                ++stats.runs;
+                stats.addDuration(test->duration());
+                if (isSuccessfulRun(test))
+                {
+                    ++stats.succeeded;
+                    continue;
+                }
+                if (not failed)
+                {
+                    failed = true;
+                    stats.firstFailure = stats.runs;
+                    failedPassed = test->passed();
+                    failedReason = test->reason();
+                    failedLocation = test->confirmLocation();
+                }
+                if (options.untilFail)
+                {
+                    break;
+                }
+            }
+
+            if (failed)
+            {
+                test->resetResult();
+                if (not failedPassed)
+                {
+                    test->setFailed(failedReason, failedLocation);
+                }
+            }
+            return stats;
+        }
+
+        // Reports a result recorded by an earlier, interrupted run.
+        inline void reportJournaled(const JournalEntry &entry, TestCounters &counters)
+        {
+            ++counters.resumed;
+            counters.add(entry.outcome);
+            *outStream << "Resumed from journal: ";
+            switch (entry.outcome)
+            {
+            case TestOutcome::Passed:
+                *outStream << "Passed" << std::endl;
+                return;
+            case TestOutcome::ExpectedFailure:
+                *outStream << "Expected failure\n";
+                break;
+            case TestOutcome::MissedFailure:
+                *outStream << "Missed expected failure" << std::endl;
+                return;
+            case TestOutcome::Quarantined:
+                *outStream << "Quarantined failure. Reported as a warning.\n";
+                break;
+            case TestOutcome::Failed:
+                if (entry.confirmLocation != -1)
+                {
+                    *outStream << "Failed confirm on line " << entry.confirmLocation << std::endl;
+                }
+                else
+                {
+                    *outStream << "Failed\n";
+                }
+                break;
+            }
+            *outStream << entry.reason << std::endl;
+        }
+
+        inline void printTestSummary(const TestCounters &counters)
+        {
+            *outStream << "-------------------------" << std::endl;
+
+            *outStream << "Tests passed: " << counters.passed
+                       << "\nTests failed: " << counters.failed;
+
+            if (counters.missedFailures != 0)
+            {
+                *outStream << "\nMissed failures: " << counters.missedFailures;
+            }
+            if (counters.quarantined != 0)
+            {
+                *outStream << "\nQuarantined failures: " << counters.quarantined;
+            }
+            if (counters.resumed != 0)
+            {
+                *outStream << "\nResumed from journal: " << counters.resumed;
+            }
+            if (not counters.flaky.empty())
+            {
+                *outStream << "\nFlaky tests: " << counters.flaky.size();
+                for (auto name : counters.flaky)
+                {
+                    *outStream << "\n    " << name;
+                }
+            }
+            if (counters.resources.sampled)
+            {
+                *outStream << "\nResources used by all tests:\n"
+                           << counters.resources;
+            }
+            *outStream << std::endl;
+        }
+    }
+
+    class Runner
+    {
+    public:
+        static int runAllTests()
+        {
+            resetResults();
+            int failed = runAllSuites();
+            stopProgress();
+
+            if (not getTracer().write())
+            {
+                *outStream << "Unable to write trace file " << getTracer().path() << std::endl;
+            }
+            return failed;
+        }
+
+    private:
+        // Releases the previous run's reasons, so nothing may still view them.
+        static void resetResults()
+        {
+            for (auto const &[suiteName, tests] : getTests())
+            {
+                for (auto *test : tests)
+                {
+                    test->resetResult();
+                    test->setExpectedFailureReason({});
+                }
+            }
+            for (auto const &[suiteName, suites] : getTestSuites())
+            {
+                for (auto *suite : suites)
+                {
+                    suite->resetResult();
+                }
+            }
+            getReasonArena().reset();
+        }
+
+        static int runAllSuites()
+        {
+            TestCounters counters;
+            *outStream << "Running " << getTests().size() << " test suites\n";
+
+            if (not openJournal() || not openHistory() || not openCoverage())
+            {
+                return 1;
+            }
+
+            if (getRunOptions().counters && not getCounterSampler().hasHardware())
+            {
+                *outStream << "Hardware counters unavailable. Sampling software counters only.\n";
+            }
+            startProgress();
+
+            for (auto const &[suiteName, tests] : getTests())
+            {
+                printSuiteHeader(suiteName);
+
+                if (isSuiteNotFound(suiteName))
+                {
+                    return ++counters.failed;
+                }
+
+                if (not hasSelectedTest(tests))
+                {
+                    *outStream << "No selected tests. Skipping suite." << std::endl;
+                    continue;
+                }
+
+                if (not std::any_of(tests.begin(), tests.end(), needsRun))
+                {
+                    // Every selected test already has a journaled result,
+                    // so the suite setup and teardown are not needed.
+                    for (auto *test : tests)
+                    {
+                        runTest(test, counters);
+                    }
+                    continue;
+                }
+
+                getCoverageMap().beginSuite();
+                getCoverageRecorder().begin();
+                if (!runSuiteSetup(suiteName, counters))
+                {
+                    continue;
+                }
+                getCoverageRecorder().collect(getCoverageMap(), getCoverageMap().suiteCoverage());
+
+                getCoverageRecorder().begin();
+                runAsyncTests(tests);
+                getCoverageRecorder().collect(getCoverageMap(), getCoverageMap().asyncCoverage());
+
+                for (auto *test : tests)
+                {
+                    runTest(test, counters);
+                }
+
+                runSuiteTeardown(suiteName, counters);
+            }
+
+            getJournal().close();
+            getHistory().close();
+            writeCoverageMap();
+            stopProgress();
+            TraceScope trace("Summary", "report");
+            detail::printTestSummary(counters);
+            return counters.failed;
+        }
+
+        static Journal &getJournal()
+        {
+            static Journal journal;
+
+            return journal;
+        }
+
+        static History &getHistory()
+        {
+            static History history;
+
+            return history;
+        }
+
+        static bool openHistory()
+        {
+            std::string const &path = getRunOptions().historyPath;
+            if (path.empty())
+            {
+                return true;
+            }
+            if (not getHistory().open(path))
+            {
+                *outStream << "Unable to open history " << path << std::endl;
+                return false;
+            }
+            getHistory().beginRun();
+            return true;
+        }
+
+        static bool openJournal()
+        {
+            RunOptions const &options = getRunOptions();
+            if (options.journalPath.empty())
+            {
+                return true;
+            }
+            if (not getJournal().open(options.journalPath, options.resume))
+            {
+                *outStream << "Unable to open journal " << options.journalPath << std::endl;
+                return false;
+            }
+            if (options.resume)
+            {
+                *outStream << "Resuming with " << getJournal().size() << " journaled results\n";
+            }
+            if (getJournal().discarded() != 0)
+            {
+                *outStream << "Discarded " << getJournal().discarded()
+                           << " bytes of incomplete or corrupt journal data\n";
+            }
+            return true;
+        }
+
+        static CoverageRecorder &getCoverageRecorder()
+        {
+            static CoverageRecorder recorder;
+
+            return recorder;
+        }
+
+        // A coverage map is recorded unless it is being used to select tests.
+        // The recorded tests are merged into the existing map, so a run
+        // narrowed by --filter keeps the coverage of the tests it skipped.
+        static bool openCoverage()
+        {
+            RunOptions const &options = getRunOptions();
+            if (options.coverageMapPath.empty() || not options.changedFilesPath.empty())
+            {
+                return true;
+            }
+            if (not getCoverageRecorder().open(options.coverageDirectory))
+            {
+                *outStream << "Unable to record coverage. Build with --coverage and TDD_COVERAGE defined, "
+                           << "and check --coverage-dir " << options.coverageDirectory << std::endl;
+                return false;
+            }
+            if (std::filesystem::exists(options.coverageMapPath) && not getCoverageMap().read(options.coverageMapPath))
+            {
+                *outStream << "Unable to read coverage map " << options.coverageMapPath << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        static void recordCoverage(const Test *test)
+        {
+            if (not getCoverageRecorder().isOpen())
+            {
+                return;
+            }
+            CoverageSet coverage;
+            getCoverageRecorder().collect(getCoverageMap(), coverage);
+            if (dynamic_cast<const AsyncTest *>(test) != nullptr)
+            {
+                coverage.insert(getCoverageMap().asyncCoverage().begin(), getCoverageMap().asyncCoverage().end());
+            }
+            getCoverageMap().add(test->suiteName(), test->name(), coverage);
+        }
+
+        static void writeCoverageMap()
+        {
+            if (not getCoverageRecorder().isOpen())
+            {
+                return;
+            }
+            std::string const &path = getRunOptions().coverageMapPath;
+            if (getCoverageMap().write(path))
+            {
+                *outStream << "Wrote coverage of " << getCoverageMap().size() << " tests to " << path << std::endl;
+            }
+            else
+            {
+                *outStream << "Unable to write coverage map " << path << std::endl;
+            }
+        }
+
+        static ProgressDisplay &getProgress()
+        {
+            static ProgressDisplay progress;
+
+            return progress;
+        }
+
+        // A test's last duration in the history is its expected duration.
+        static std::int64_t estimateOf(const Test *test)
+        {
+            if (getHistory().isOpen())
+            {
+                auto const *history = getHistory().find(test->suiteName(), test->name());
+                if (history != nullptr && not history->rows.empty())
+                {
+                    return history->rows.back().durationNs;
+                }
+            }
+            return -1;
+        }
+
+        // The status line is only drawn when the output is a terminal, so
+        // redirected output stays plain text.
+        static void startProgress()
+        {
+            if (not getRunOptions().progress || not ProgressDisplay::isTerminal(*outStream))
+            {
+                return;
+            }
+            int total = 0;
+            int unestimated = 0;
+            std::int64_t estimateNs = 0;
+            for (auto const &[suiteName, tests] : getTests())
+            {
+                for (auto const *test : tests)
+                {
+                    if (detail::isSelected(test))
+                    {
+                        ++total;
+                        std::int64_t estimate = estimateOf(test);
+                        if (estimate < 0)
+                        {
+                            ++unestimated;
+                        }
+                        else
+                        {
+                            estimateNs += estimate;
+                        }
+                    }
+                }
+            }
+            getProgress().start(*outStream, total, estimateNs, unestimated);
+            outStream = &getProgress().stream();
+        }
+
+        static void stopProgress()
+        {
+            if (getProgress().isActive())
+            {
+                std::ostream &terminal = getProgress().terminal();
+                getProgress().stop();
+                outStream = &terminal;
+            }
+        }
+
+        static bool needsRun(const Test *test)
+        {
+            return detail::needsRun(test, getJournal());
+        }
+
+        static void printSuiteHeader(const std::string_view suiteName)
+        {
+            std::string suiteDisplayName = "Suite: ";
+            suiteDisplayName += suiteName.empty() ? "Single Tests" : suiteName;
+
+            *outStream << "------------------ " << suiteDisplayName << std::endl;
+        }
+
+        static bool isSuiteNotFound(std::string_view suiteName)
+        {
+            if (not suiteName.empty() && not getTestSuites().contains(suiteName))
+            {
+                *outStream << "Test suite is not found. Exiting test application." << std::endl;
+                return true;
+            }
+            return false;
+        }
+
+        static bool runSuiteSetup(std::string_view suiteName, TestCounters &counters)
+        {
+            if (not suiteName.empty() && not runSuite(true, suiteName, counters))
+            {
+                *outStream << "Test suite setup failed. Skipping tests in suite." << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        static bool runSuiteTeardown(std::string_view suiteName, TestCounters &counters)
+        {
+            if (not suiteName.empty() && not runSuite(false, suiteName, counters))
+            {
+                *outStream << "Test suite teardown failed. Skipping tests in suite." << std::endl;
+                return false;
+            }
+            return true;
+        }
+
+        static bool hasSelectedTest(const std::vector<Test *> &tests)
+        {
+            return std::any_of(tests.begin(), tests.end(), detail::isSelected);
+        }
+
+        // Async tests all run on the event loop before any result is
+        // reported. Reporting then collects each test's stored outcome.
+        static void runAsyncTests(const std::vector<Test *> &tests)
+        {
+            // Repeated tests start a new coroutine for every run instead.
+            if (isRepeating())
+            {
+                return;
+            }
+            std::vector<AsyncTest *> started;
+            for (auto *test : tests)
+            {
+                auto *asyncTest = dynamic_cast<AsyncTest *>(test);
+                if (asyncTest != nullptr && needsRun(test))
+                {
+                    asyncTest->start();
+                    started.push_back(asyncTest);
+                }
+            }
+            if (started.empty())
+            {
+                return;
+            }
+
+            TraceScope trace("Async tests", "test");
+            // Confirms on threads started by the tests are captured, as
+            // they are for any test, instead of throwing there.
+            getThreadConfirms().begin();
+            getEventLoop().run();
+            getThreadConfirms().stop();
+            for (auto *asyncTest : started)
+            {
+                asyncTest->claimThreadFailure();
+            }
+        }
+
+        static bool isRepeating()
+        {
+            return getRunOptions().repeat > 1 || getRunOptions().untilFail;
+        }
+
+        // Async tests run interleaved before their suite's tests are reported.
+        static bool ranOnEventLoop(const Test *test)
+        {
+            return not isRepeating() && dynamic_cast<const AsyncTest *>(test) != nullptr;
+        }
+
+        static void runTest(Test *test, TestCounters &counters)
+        {
+            if (not detail::isSelected(test))
+            {
+                return;
+            }
+            std::int64_t estimate = estimateOf(test);
+            getProgress().testStarted(test);
+            *outStream << "------------ Test: " << test->name() << std::endl;
+            if (auto const *entry = getRunOptions().resume ? getJournal().find(test) : nullptr)
+            {
+                detail::reportJournaled(*entry, counters);
+                getProgress().testFinished(entry->outcome, estimate);
+                return;
+            }
+
+            RepeatStats stats;
+            getCoverageRecorder().begin();
+            if (isRepeating())
+            {
+                stats = detail::repeatTest(test, runTestOnce);
+            }
+            else
+            {
+                runTestOnce(test);
+            }
+
+            TraceScope trace("Report", "report");
+            recordCoverage(test);
+            updateTestCounters(test, counters);
+            getProgress().testFinished(detail::outcomeOf(test), estimate, ranOnEventLoop(test) ? test->duration().count() : -1);
+            if (getJournal().isOpen())
+            {
+                getJournal().append(test, detail::outcomeOf(test));
+            }
+            if (getHistory().isOpen())
+            {
+                getHistory().append(test, detail::outcomeOf(test));
+            }
+            if (test->counters().sampled)
+            {
+                *outStream << test->counters() << std::endl;
+                addResources(counters.resources, test->counters());
+            }
+            if (stats.runs != 0)
+            {
+                printRepeatStats(stats);
+                if (stats.flaky())
+                {
+                    counters.flaky.push_back(test->name());
+                }
+            }
+        }
+
+        static void runTestOnce(Test *test)
+        {
+            auto *asyncTest = dynamic_cast<AsyncTest *>(test);
+            // Counters cannot single out one of the interleaved async tests.
+            bool sampled = getRunOptions().counters && not ranOnEventLoop(test);
+            test->resetResult();
+            std::int64_t traceBegin = getTracer().begin();
+            if (sampled)
+            {
+                getCounterSampler().start();
+            }
+            auto start = std::chrono::steady_clock::now();
+            handleTest(test);
+            test->setDuration(asyncTest != nullptr ? asyncTest->taskDuration() : std::chrono::steady_clock::now() - start);
+            if (sampled)
+            {
+                test->setCounters(getCounterSampler().stop());
+            }
+            getTracer().record(test->name(), "test", traceBegin, &test->counters());
+        }
+
+        static void printRepeatStats(const RepeatStats &stats)
+        {
+            double deviation = stats.standardDeviationNs();
+            *outStream << "Repeated " << stats.runs << " times: " << stats.succeeded << " succeeded ("
+                       << 100 * stats.succeeded / stats.runs << "%)\n"
+                       << "    Mean: " << formatDuration(std::chrono::nanoseconds(static_cast<std::int64_t>(stats.meanNs)))
+                       << "  Std dev: " << formatDuration(std::chrono::nanoseconds(static_cast<std::int64_t>(deviation)));
+            if (stats.firstFailure != 0)
+            {
+                *outStream << "\n    First failure on run " << stats.firstFailure;
+            }
+            if (stats.flaky())
+            {
+                *outStream << "\nFlaky";
+            }
+            *outStream << std::endl;
+        }
+
+        static CounterSampler &getCounterSampler()
+        {
+            static CounterSampler sampler;
+
+            return sampler;
+        }
+
+        static void addResources(ResourceCounters &total, ResourceCounters const &used)
+        {
+            auto add = [](std::int64_t &sum, std::int64_t value)
+            {
+                if (value >= 0)
+                {
+                    sum = (sum < 0 ? 0 : sum) + value;
+                }
+            };
+            add(total.cycles, used.cycles);
+            add(total.instructions, used.instructions);
+            add(total.cacheMisses, used.cacheMisses);
+            add(total.branchMisses, used.branchMisses);
+            total.pageFaults += used.pageFaults;
+            total.contextSwitches += used.contextSwitches;
+            total.maxRssKb = std::max(total.maxRssKb, used.maxRssKb);
+            total.sampled = true;
+        }
+
+        static bool runSuite(bool setup, std::string_view name, TestCounters &counters)
+        {
+            bool result = true;
+            for (auto &suite : getTestSuites()[name])
+            {
+                if (setup)
+                {
+                    *outStream << "------------ Setup: ";
+                }
+                else
+                {
+                    *outStream << "------------ Teardown: ";
+                }
+                *outStream << suite->name() << std::endl;
+                {
+                    TraceScope trace(suite->name(), setup ? "setup" : "teardown");
+                    handleSuite(suite, setup);
+                }
+                if (isSuiteFailed(suite, counters))
+                {
+                    return false;
+                }
+            }
+            return result;
+        }
+
+        static void handleMissingException(TestBase *test, const MissingException &ex)
+        {
+            // Expected exception type int was not thrown
+            std::string message = "Expected exception type ";
+            message += ex.exceptionType();
+            message += " was not thrown.";
+            test->setFailed(message);
+        }
+
+        static void handleConfirmException(TestBase *test, const ConfirmException &ex)
+        {
+            test->setFailed(ex.reason(), ex.line());
+        }
+
+        static void handleUnexpectedException(TestBase *test)
+        {
+            test->setFailed("Unexpected exception thrown.");
+        }
+
+        static void handleTest(Test *test)
+        {
+            getThreadConfirms().begin();
+            try
+            {
+                test->runEx();
+            }
+            catch (const ConfirmException &ex)
+            {
+                handleConfirmException(test, ex);
+            }
+            catch (const MissingException &ex)
+            {
+                handleMissingException(test, ex);
+            }
+            catch (...)
+            {
+                handleUnexpectedException(test);
+            }
+            getThreadConfirms().end(test);
+        }
+
+        static void handleSuite(TestSuite *suite, bool setup)
+        {
+            getThreadConfirms().begin();
+            try
+            {
+                if (setup)
+                {
+                    suite->suiteSetup();
+                }
+                else
+                {
+                    suite->suiteTeardown();
+                }
+            }
+            catch (const ConfirmException &ex)
+            {
+                handleConfirmException(suite, ex);
+            }
+            catch (...)
+            {
+                handleUnexpectedException(suite);
+            }
+            getThreadConfirms().end(suite);
+        }
+
+        static void verifyConfirmLocation(const TestBase *test)
+        {
+            if (test->confirmLocation() != -1)
+            {
+                *outStream << "Failed confirm on line " << test->confirmLocation() << std::endl;
+            }
+            else
+            {
+                *outStream << "Failed\n";
+            }
+            *outStream << test->reason() << std::endl;
+        }
+
+        static bool isSuiteFailed(TestSuite *suite, TestCounters &counters)
+        {
+            if (not suite->passed())
+            {
+                ++counters.failed;
+                verifyConfirmLocation(suite);
+                return true;
+            }
+            ++counters.passed;
+            *outStream << "Passed" << std::endl;
+            return false;
+        }
+
+        static void updateTestCounters(Test *test, TestCounters &counters)
+        {
+            TestOutcome outcome = detail::outcomeOf(test);
+            counters.add(outcome);
+            switch (outcome)
+            {
+            case TestOutcome::Passed:
+                *outStream << "Passed" << std::endl;
+                break;
+            case TestOutcome::MissedFailure:
+                *outStream << "Missed expected failure\n"
+                           << "Test passed but was expected to fail." << std::endl;
+                break;
+            case TestOutcome::ExpectedFailure:
+                *outStream << "Expected failure\n"
+                           << test->reason() << std::endl;
+                break;
+            case TestOutcome::Quarantined:
+                *outStream << "Quarantined failure. Reported as a warning.\n"
+                           << test->reason() << std::endl;
+                break;
+            case TestOutcome::Failed:
+                verifyConfirmLocation(test);
+                break;
+            }
+        }
+    };
+
+    template <typename T>
+    class SetupAndTeardown : public T
+    {
+
+    public:
+        SetupAndTeardown(/* args */)
+        {
+            T::setup();
+        }
+        ~SetupAndTeardown()
+        {
+            T::teardown();
+        }
+    };
+
+    template <typename T>
+    class TestSuiteSetupAndTeardown : public T, public TestSuite
+    {
+    public:
+        TestSuiteSetupAndTeardown(std::string_view name, std::string_view suite)
+            : TestSuite(name, suite) {}
+
+        void suiteSetup() override { T::setup(); }
+
+        void suiteTeardown() override { T::teardown(); }
+    };
+
+    // Injectable source of time for code under test. Timers fire in
+    // deadline order while the clock sleeps, on whichever thread sleeps.
+    // Any thread may schedule timers, and callbacks run without the lock
+    // held, so they may schedule more. Runner timings always use std::chrono::steady_clock directly, so time
+    // spent in a virtual clock never shows up as wall time.
+    class Clock
+    {
+    public:
+        using time_point = std::chrono::steady_clock::time_point;
+
+        virtual ~Clock() = default;
+
+        virtual time_point now() const = 0;
+
+        void sleepFor(std::chrono::nanoseconds duration)
+        {
+            advanceTo(now() + duration);
+        }
+
+        void callAfter(std::chrono::nanoseconds delay, std::function<void()> callback)
+        {
+            time_point when = now() + delay;
+            std::lock_guard lock(mMutex);
+            mTimers.push({when, mNextSequence++, std::move(callback)});
+        }
+
+        std::size_t pendingTimers() const
+        {
+            std::lock_guard lock(mMutex);
+            return mTimers.size();
+        }
+
+        // Fires timers until none remain and returns how many fired. Timers
+        // that keep rescheduling themselves stop after maxTimers.
+        std::size_t runUntilIdle(std::size_t maxTimers = 100'000)
+        {
+            std::size_t fired = 0;
+            while (fired < maxTimers && fireNext(time_point::max()))
+            {
+                ++fired;
+            }
+            return fired;
+        }
+
+    protected:
+        virtual void waitUntil(time_point when) = 0;
+
+    private:
+        struct Timer
+        {
+            time_point when;
+            std::uint64_t sequence; // keeps timers with equal deadlines in order
+            std::function<void()> callback;
+
+            bool operator>(Timer const &other) const
+            {
+                return when != other.when ? when > other.when : sequence > other.sequence;
+            }
+        };
+
+        void advanceTo(time_point target)
+        {
+            while (fireNext(target))
+            {
+            }
+            waitUntil(target);
+        }
+
+        // Fires the earliest timer due by target. Returns false when none is.
+        bool fireNext(time_point target)
+        {
+            std::unique_lock lock(mMutex);
+            if (mTimers.empty() || mTimers.top().when > target)
+            {
+                return false;
+            }
+            // Pop before calling so the callback can schedule more timers.
+            Timer timer = mTimers.top();
+            mTimers.pop();
+            lock.unlock();
+            waitUntil(timer.when);
+            timer.callback();
+            return true;
+        }
+
+        mutable std::mutex mMutex;
+        std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> mTimers;
+        std::uint64_t mNextSequence = 0;
+    };
+
+    class SystemClock : public Clock
+    {
+    public:
+        time_point now() const override
+        {
+            return std::chrono::steady_clock::now();
+        }
+
+    protected:
+        void waitUntil(time_point when) override
+        {
+            std::this_thread::sleep_until(when);
+        }
+    };
+
+    // Time only moves when advanced, so time based scenarios run instantly
+    // and deterministically. Sleeping on a virtual clock advances it.
+    class VirtualClock : public Clock
+    {
+    public:
+        time_point now() const override { return mNow; }
+
+        void advance(std::chrono::nanoseconds duration)
+        {
+            sleepFor(duration);
+        }
+
+        std::chrono::nanoseconds elapsed() const
+        {
+            return mNow - time_point{};
+        }
+
+    protected:
+        void waitUntil(time_point when) override
+        {
+            mNow = std::max(mNow, when);
+        }
+
+    private:
+        time_point mNow{};
+    };
+
+    inline Clock *&currentClock()
+    {
+        thread_local Clock *clock = nullptr;
+
+        return clock;
+    }
+
+    // The clock code under test should use. This is the system clock unless
+    // a test on the same thread installed a virtual one.
+    inline Clock &getClock()
+    {
+        static SystemClock systemClock;
+
+        Clock *clock = currentClock();
+        return clock != nullptr ? *clock : systemClock;
+    }
+
+    // Opts a test into virtual time:
+    //     TDD::SetupAndTeardown<TDD::VirtualTime> time;
+    //     time.advance(5s);
+    // Virtual time applies to the test's own thread and does not change
+    // TDD::sleepFor in async tests, which share one event loop.
+    class VirtualTime : public VirtualClock
+    {
+    public:
+        void setup()
+        {
+            mPrevious = currentClock();
+            currentClock() = this;
+        }
+
+        void teardown()
+        {
+            currentClock() = mPrevious;
+        }
+
+    private:
+        Clock *mPrevious = nullptr;
+    };
+
+    // Keeps the Runner alive and reruns tests built as shared objects. Each
+    // .so in the watched directory is loaded with dlopen and its tests run.
+    // When inotify reports that one was rebuilt, only that object is
+    // unloaded, reloaded and run again. A deleted object is unloaded and its
+    // tests unregistered. Requirements:
+    //   - Link the server with -rdynamic, so the objects share its registry.
+    //   - Build the objects with -fno-gnu-unique. Otherwise the inline
+    //     statics from this header stop dlclose from unloading them.
+    class WatchServer
+    {
+    public:
+        explicit WatchServer(std::filesystem::path directory)
+            : mDirectory(std::move(directory)) {}
+
+#if defined(__linux__)
+        ~WatchServer()
+        {
+            getTracer().clear();
+            for (auto &[path, handle] : mLibraries)
+            {
+                dlclose(handle);
+            }
+        }
+
+        int run()
+        {
+            int watch = inotify_init1(IN_CLOEXEC);
+            if (watch == -1 || inotify_add_watch(watch, mDirectory.c_str(),
+                                                IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM) == -1)
+            {
+                if (watch != -1)
+                {
+                    close(watch);
+                }
+                *outStream << "Unable to watch " << mDirectory.string() << std::endl;
+                return 1;
+            }
+
+            std::set<std::filesystem::path> changed;
+            std::error_code error;
+            for (auto const &entry : std::filesystem::directory_iterator(mDirectory, error))
+            {
+                if (isSharedObject(entry.path()))
+                {
+                    changed.insert(entry.path());
+                }
+            }
+
+            while (true)
+            {
+                if (not changed.empty())
+                {
+                    reload(changed);
+                    changed.clear();
+                    *outStream << "Watching " << mDirectory.string() << " for changes." << std::endl;
+                }
+                if (not readChanges(watch, changed))
+                {
+                    close(watch);
+                    return 1;
+                }
+            }
+        }
+
+        // Unloads the objects, loads again the ones that still exist and
+        // runs only the tests they added.
+        void reload(std::set<std::filesystem::path> const &paths)
+        {
+            // Events may still name tests from the objects being unloaded.
+            getTracer().clear();
+
+            for (auto const &path : paths)
+            {
+                unload(path);
+            }
+            std::set<const Test *> before = registeredTests();
+            for (auto const &path : paths)
+            {
+                std::error_code error;
+                if (std::filesystem::exists(path, error))
+                {
+                    load(path);
+                }
+                else
+                {
+                    *outStream << "Removed " << path.string() << std::endl;
+                }
+            }
+
+            std::set<const Test *> added;
+            for (auto const *test : registeredTests())
+            {
+                if (not before.contains(test))
+                {
+                    added.insert(test);
+                }
+            }
+            if (added.empty())
+            {
+                return;
+            }
+            getRunOptions().selected = std::move(added);
+            Runner::runAllTests();
+            getRunOptions().selected.clear();
+        }
+
+    private:
+        static bool isSharedObject(std::filesystem::path const &path)
+        {
+            return path.extension() == ".so";
+        }
+
+        // Blocks for the first event, then keeps collecting until the build
+        // has been quiet for a moment so one rebuild causes a single rerun.
+        bool readChanges(int watch, std::set<std::filesystem::path> &changed)
+        {
+            alignas(inotify_event) char buffer[4096];
+            int timeout = -1;
+            while (true)
+            {
+                pollfd request{watch, POLLIN, 0};
+                int ready = poll(&request, 1, timeout);
+                if (ready == 0)
+                {
+                    return true;
+                }
+                ssize_t length = ready > 0 ? read(watch, buffer, sizeof(buffer)) : -1;
+                if (length == -1 && errno == EINTR)
+                {
+                    // A signal such as SIGWINCH is no reason to stop watching.
+                    continue;
+                }
+                if (length <= 0)
+                {
+                    return false;
+                }
+                for (ssize_t offset = 0; offset < length;)
+                {
+                    auto *event = reinterpret_cast<inotify_event *>(buffer + offset);
+                    if (event->len != 0 && isSharedObject(event->name))
+                    {
+                        changed.insert(mDirectory / event->name);
+                    }
+                    offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                }
+                timeout = 200;
+            }
+        }
+
+        void load(std::filesystem::path const &path)
+        {
+            // dlopen caches by path and the linker may rewrite the file in
+            // place, so each build is loaded from its own private copy.
+            std::error_code error;
+            std::filesystem::path copy = std::filesystem::temp_directory_path(error) /
+                                         ("tdd-" + std::to_string(getpid()) + "-" +
+                                          std::to_string(mNextCopy++) + "-" + path.filename().string());
+            if (not std::filesystem::copy_file(path, copy, std::filesystem::copy_options::overwrite_existing, error))
+            {
+                *outStream << "Unable to copy " << path.string() << std::endl;
+                return;
+            }
+            void *handle = dlopen(copy.c_str(), RTLD_NOW | RTLD_LOCAL);
+            std::filesystem::remove(copy, error);
+            if (handle == nullptr)
+            {
+                *outStream << "Unable to load " << path.string() << ": " << dlerror() << std::endl;
+                return;
+            }
+            *outStream << "Loaded " << path.string() << std::endl;
+            mLibraries[path] = handle;
+        }
+
+        void unload(std::filesystem::path const &path)
+        {
+            auto found = mLibraries.find(path);
+            if (found == mLibraries.end())
+            {
+                return;
+            }
+            // Static destructors in the object unregister its tests.
+            dlclose(found->second);
+            mLibraries.erase(found);
+        }
+
+        static std::set<const Test *> registeredTests()
+        {
+            std::set<const Test *> tests;
+            for (auto const &[suiteName, suiteTests] : getTests())
+            {
+                tests.insert(suiteTests.begin(), suiteTests.end());
+            }
+            return tests;
+        }
+
+        std::map<std::filesystem::path, void *> mLibraries;
+        int mNextCopy = 0;
+#else
+        int run()
+        {
+            *outStream << "Watch mode requires Linux." << std::endl;
+            return 1;
+        }
+
+    private:
+#endif
+        std::filesystem::path mDirectory;
+    };
+
+    inline void setOutStream(std::ostream &os)
+    {
+        outStream = &os;
+    }
+
+    inline std::map<std::string_view, std::vector<Test *>> &getTests()
+    {
+        static std::map<std::string_view, std::vector<Test *>> tests;
+
+        return tests;
+    }
+
+    inline std::map<std::string_view, std::vector<TestSuite *>> &getTestSuites()
+    {
+        static std::map<std::string_view, std::vector<TestSuite *>> suites;
+
+        return suites;
+    }
+
+    // Registry keys view the suite name of the first test registered in the
+    // suite, so no name is copied.
+    inline void addTest(std::string_view suiteName, Test *test)
+    {
+        getTests()[suiteName].push_back(test);
+    }
+
+    inline void addTestSuite(std::string_view suiteName, TestSuite *suite)
+    {
+        getTestSuites()[suiteName].push_back(suite);
+    }
+
+    template <typename T>
+    void removeRegistered(std::map<std::string_view, std::vector<T *>> &registry, std::string_view suiteName, T *entry)
+    {
+        auto found = registry.find(suiteName);
+        if (found == registry.end())
+        {
+            return;
+        }
+        std::erase(found->second, entry);
+        if (found->second.empty())
+        {
+            registry.erase(found);
+        }
+        else if (found->first.data() == suiteName.data())
+        {
+            // The key viewed the name owned by the removed entry, which may
+            // be about to be unloaded, so view a remaining entry's name instead.
+            auto node = registry.extract(found);
+            node.key() = node.mapped().front()->suiteName();
+            registry.insert(std::move(node));
+        }
+    }
+
+    inline void removeTest(std::string_view suiteName, Test *test)
+    {
+        removeRegistered(getTests(), suiteName, test);
+    }
+
+    inline void removeTestSuite(std::string_view suiteName, TestSuite *suite)
+    {
+        removeRegistered(getTestSuites(), suiteName, suite);
+    }
+
+    inline void runTests()
+    {
+        Runner::runAllTests();
+    }
+
+    // Quarantine files list one test name per line. Lines starting with # are comments.
+    inline bool readQuarantine(std::string_view path)
+    {
+        std::ifstream file{std::string(path)};
+        if (not file.is_open())
+        {
+            return false;
+        }
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (not line.empty() && line.front() != '#')
+            {
+                getRunOptions().quarantine.insert(line);
+            }
+        }
+        return true;
+    }
+
+    // Selects the tests whose recorded coverage includes a changed file.
+    // The changed files are listed one per line, as git diff --name-only
+    // prints them, and a path of - reads the list from standard input.
+    inline bool selectChangedTests()
+    {
+        RunOptions &options = getRunOptions();
+        CoverageMap &map = getCoverageMap();
+        if (options.coverageMapPath.empty() || not map.read(options.coverageMapPath))
+        {
+            *outStream << "--changed-files requires a readable --coverage-map <file>" << std::endl;
+            return false;
+        }
+        std::ifstream file;
+        if (options.changedFilesPath != "-")
+        {
+            file.open(options.changedFilesPath);
+            if (not file.is_open())
+            {
+                *outStream << "Unable to read changed files " << options.changedFilesPath << std::endl;
+                return false;
+            }
+        }
+        std::istream &input = options.changedFilesPath == "-" ? std::cin : file;
+        std::vector<std::filesystem::path> changedFiles;
+        std::string line;
+        while (std::getline(input, line))
+        {
+            if (not line.empty())
+            {
+                changedFiles.emplace_back(std::filesystem::path(line).lexically_normal());
+            }
+        }
+
+        std::vector<bool> changedFunctions = map.changedFunctions(changedFiles);
+        std::size_t total = 0;
+        for (auto const &[suiteName, tests] : getTests())
+        {
+            for (auto const *test : tests)
+            {
+                ++total;
+                if (map.isAffected(test->suiteName(), test->name(), changedFunctions))
+                {
+                    options.selected.insert(test);
+                }
+            }
+        }
+        *outStream << "Selected " << options.selected.size() << " of " << total << " tests affected by "
+                   << changedFiles.size() << " changed files\n";
+        return true;
+    }
+
+    inline int showHistory()
+    {
+        RunOptions const &options = getRunOptions();
+        History history;
+        if (options.historyPath.empty() || not history.open(options.historyPath))
+        {
+            *outStream << "--history requires a readable --history-file <file>" << std::endl;
+            return 1;
+        }
+        HistoryReport report(history, static_cast<std::uint32_t>(options.historyRuns));
+        report.printTrend(options.historyQuery);
+        report.printLargestGrowth(10);
+        return 0;
+    }
+
+    // Reads a whole decimal count of at least minimum.
+    inline bool parseCount(std::string_view text, int minimum, int &count)
+    {
+        int value = 0;
+        auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (error != std::errc{} || end != text.data() + text.size() || value < minimum)
+        {
+            return false;
+        }
+        count = value;
+        return true;
+    }
+
+    // Supported options:
+    //   --trace <file>       Write a Chrome/Perfetto trace of the run to file.
+    //   --counters           Sample hardware and OS resource counters per test.
+    //   --filter <text>      Run only tests whose name contains text.
+    //   --repeat <count>     Run each selected test count times.
+    //   --until-fail         Stop repeating a test at its first failure.
+    //   --quarantine <file>  Report failures of the tests named in file,
+    //                        one per line, as warnings.
+    //   --journal <file>     Append each completed result to file.
+    //   --resume             Skip tests whose results are already in the
+    //                        journal and report them with the new results.
+    //   --snapshot-dir <dir> Directory of golden files. Defaults to snapshots.
+    //   --update-snapshots   Rewrite golden files that are missing or differ.
+    //   --history-file <file>  Append every result to the run history in file.
+    //   --history <text>     Instead of running tests, show the timing trend
+    //                        of tests whose name contains text, then the
+    //                        tests whose duration grew most.
+    //   --last <runs>        Runs covered by --history. Defaults to 10.
+    //   --watch <directory>  Load the test shared objects in directory, run
+    //                        them and rerun each one whenever it is rebuilt.
+    //   --coverage-map <file>  Record the files and functions each test
+    //                        executes to file. Tests that do not run keep
+    //                        the coverage already in file. Needs a
+    //                        --coverage build with TDD_COVERAGE defined.
+    //   --coverage-dir <dir> Directory searched for the .gcda files of a
+    //                        --coverage build. They are removed as they are
+    //                        read. Defaults to the current directory.
+    //   --changed-files <file>  Run only the tests whose coverage in the
+    //                        --coverage-map includes a file listed in file.
+    //   --no-progress        Do not show the live status line on terminals.
+    inline bool parseArguments(int argc, const char **argv)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string_view arg = argv[i];
+            if (arg == "--trace" && i + 1 < argc)
+            {
+                getTracer().enable(argv[++i]);
+            }
+            else if (arg == "--counters")
+            {
+                getRunOptions().counters = true;
+            }
+            else if (arg == "--filter" && i + 1 < argc)
+            {
+                getRunOptions().filter = argv[++i];
+            }
+            else if (arg == "--repeat" && i + 1 < argc)
+            {
+                if (not parseCount(argv[++i], 1, getRunOptions().repeat))
+                {
+                    *outStream << "--repeat needs a count of at least 1, not " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (arg == "--until-fail")
+            {
+                getRunOptions().untilFail = true;
+            }
+            else if (arg == "--journal" && i + 1 < argc)
+            {
+                getRunOptions().journalPath = argv[++i];
+            }
+            else if (arg == "--resume")
+            {
+                getRunOptions().resume = true;
+            }
+            else if (arg == "--snapshot-dir" && i + 1 < argc)
+            {
+                getRunOptions().snapshotDirectory = argv[++i];
+            }
+            else if (arg == "--update-snapshots")
+            {
+                getRunOptions().updateSnapshots = true;
+            }
+            else if (arg == "--history-file" && i + 1 < argc)
+            {
+                getRunOptions().historyPath = argv[++i];
+            }
+            else if (arg == "--history" && i + 1 < argc)
+            {
+                getRunOptions().queryHistory = true;
+                getRunOptions().historyQuery = argv[++i];
+            }
+            else if (arg == "--last" && i + 1 < argc)
+            {
+                if (not parseCount(argv[++i], 2, getRunOptions().historyRuns))
+                {
+                    *outStream << "--last needs a count of at least 2, not " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else if (arg == "--watch" && i + 1 < argc)
+            {
+                getRunOptions().watchDirectory = argv[++i];
+            }
+            else if (arg == "--coverage-map" && i + 1 < argc)
+            {
+                getRunOptions().coverageMapPath = argv[++i];
+            }
+            else if (arg == "--coverage-dir" && i + 1 < argc)
+            {
+                getRunOptions().coverageDirectory = argv[++i];
+            }
+            else if (arg == "--changed-files" && i + 1 < argc)
+            {
+                getRunOptions().changedFilesPath = argv[++i];
+            }
+            else if (arg == "--no-progress")
+            {
+                getRunOptions().progress = false;
+            }
+            else if (arg == "--quarantine" && i + 1 < argc)
+            {
+                if (not readQuarantine(argv[++i]))
+                {
+                    *outStream << "Unable to read quarantine file " << argv[i] << std::endl;
+                    return false;
+                }
+            }
+            else
+            {
+                *outStream << "Unknown option: " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    inline int runTests(int argc, const char **argv)
+    {
+        if (not parseArguments(argc, argv))
+        {
+            return 1;
+        }
+        if (getRunOptions().resume && getRunOptions().journalPath.empty())
+        {
+            *outStream << "--resume requires --journal <file>" << std::endl;
+            return 1;
+        }
+        if (getRunOptions().queryHistory)
+        {
+            return showHistory();
+        }
+        if (not getRunOptions().watchDirectory.empty())
+        {
+            return WatchServer(getRunOptions().watchDirectory).run();
+        }
+        if (not getRunOptions().changedFilesPath.empty())
+        {
+            if (not selectChangedTests())
+            {
+                return 1;
+            }
+            if (getRunOptions().selected.empty())
+            {
+                *outStream << "No tests are affected by the changed files." << std::endl;
+                return 0;
+            }
+        }
+        return Runner::runAllTests();
+    }
+
+    inline Tracer &getTracer()
+    {
+        static Tracer tracer;
+
+        return tracer;
+    }
+
+    inline RunOptions &getRunOptions()
+    {
+        static RunOptions options;
+
+        return options;
+    }
+
+    inline EventLoop &getEventLoop()
+    {
+        static EventLoop loop;
+
+        return loop;
+    }
+
+    inline ThreadConfirms &getThreadConfirms()
+    {
+        static ThreadConfirms confirms;
+
+        return confirms;
+    }
+
+    inline ReasonArena &getReasonArena()
+    {
+        static ReasonArena arena;
+
+        return arena;
+    }
+
+    // Coverage read by --changed-files to select tests, or read and then
+    // updated by a run that records --coverage-map.
+    inline CoverageMap &getCoverageMap()
+    {
+        static CoverageMap map;
+
+        return map;
+    }
+
+    // Specialize Formatter to control how your own types appear in failure
+    // reasons. Types without one fall back to their operator<<.
+    //
+    //     template <>
+    //     struct TDD::Formatter<Point>
+    //     {
+    //         static void format(std::string &out, Point const &value);
+    //     };
+    template <typename T>
+    struct Formatter;
+
+    template <typename T>
+    concept HasFormatter = requires(std::string &out, T const &value) {
+        Formatter<T>::format(out, value);
+    };
+
+    template <typename T>
+    concept StringLike = std::convertible_to<T const &, std::string_view>;
+
+    template <typename T>
+    concept TupleLike = requires { std::tuple_size<T>::value; };
+
+    template <typename T>
+    concept FormattableRange = std::ranges::input_range<T const> and not StringLike<T>;
+
+    template <typename T>
+    concept MapLike = FormattableRange<T> and requires {
+        typename T::key_type;
+        typename T::mapped_type;
+    };
+
+    template <typename T>
+    concept Streamable = requires(std::ostream &os, T const &value) { os << value; };
+
+    template <typename T>
+    struct IsOptional : std::false_type {};
+
+    template <typename T>
+    struct IsOptional<std::optional<T>> : std::true_type {};
+
+    template <typename T>
+    void formatValue(std::string &out, T const &value);
+
+    template <typename T>
+    void formatNumber(std::string &out, T value)
+    {
+        char digits[64];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        out.append(digits, result.ptr);
+    }
+
+    template <typename T>
+    void formatElement(std::string &out, T const &value)
+    {
+        if constexpr (StringLike<T> and not HasFormatter<T>)
+        {
+            out += '"';
+            out += std::string_view(value);
+            out += '"';
+        }
+        else
+        {
+            formatValue(out, value);
+        }
+    }
+
+    template <typename T>
+    void formatValue(std::string &out, T const &value)
+    {
+        if constexpr (HasFormatter<T>)
+        {
+            Formatter<T>::format(out, value);
+        }
+        else if constexpr (std::same_as<T, bool>)
+        {
+            out += value ? "true" : "false";
+        }
+        else if constexpr (std::is_arithmetic_v<T>)
+        {
+            formatNumber(out, value);
+        }
+        else if constexpr (std::is_enum_v<T>)
+        {
+            formatNumber(out, static_cast<std::underlying_type_t<T>>(value));
+        }
+        else if constexpr (StringLike<T>)
+        {
+            out += std::string_view(value);
+        }
+        else if constexpr (IsOptional<T>::value)
+        {
+            if (value)
+            {
+                formatElement(out, *value);
+            }
+            else
+            {
+                out += "nullopt";
+            }
+        }
+        else if constexpr (MapLike<T>)
+        {
+            out += '{';
+            bool first = true;
+            for (auto const &[key, mapped] : value)
+            {
+                out += first ? "" : ", ";
+                first = false;
+                formatElement(out, key);
+                out += ": ";
+                formatElement(out, mapped);
+            }
+            out += '}';
+        }
+        else if constexpr (FormattableRange<T>)
+        {
+            out += '[';
+            bool first = true;
+            for (auto const &element : value)
+            {
+                out += first ? "" : ", ";
+                first = false;
+                formatElement(out, element);
+            }
+            out += ']';
+        }
+        else if constexpr (TupleLike<T>)
+        {
+            out += '(';
+            std::apply([&out](auto const &...elements)
+                       {
+                           bool first = true;
+                           ((out += first ? "" : ", ", first = false, formatElement(out, elements)), ...);
+                       },
+                       value);
+            out += ')';
+        }
+        else if constexpr (Streamable<T>)
+        {
+            std::ostringstream os;
+            os << value;
+            out += os.str();
+        }
+        else
+        {
+            static_assert(sizeof(T) == 0, "Specialize TDD::Formatter or provide operator<< to confirm this type");
+        }
+    }
+
+    // Values are only formatted once a confirm fails, into a buffer that is
+    // reused across failures on the same thread.
+    template <typename ExpectedT, typename ActualT>
+    void raiseMismatch(ExpectedT const &expected, ActualT const &actual, int line)
+    {
+        thread_local std::string buffer;
+        buffer.clear();
+        formatValue(buffer, expected);
+        std::size_t split = buffer.size();
+        formatValue(buffer, actual);
+        std::string_view text = buffer;
+        raiseConfirm(TDD::ActualConfirmException(text.substr(0, split), text.substr(split), line));
+    }
+
+    inline void confirm(bool expected, bool actual, int line)
+    {
+        if (actual != expected)
+        {
+            raiseConfirm(TDD::BoolConfirmException(expected, line));
+        }
+    }
+
+    // overloaded to string_view
+    inline void confirm(std::string_view expected, std::string_view actual, int line)
+    {
+        if (actual != expected)
+        {
+            raiseConfirm(TDD::ActualConfirmException(expected, actual, line));
+        }
+    }
+
+    // overloaded to strings
+    inline void confirm(std::string const &expected, std::string const &actual, int line)
+    {
+        confirm(std::string_view(expected), std::string_view(actual), line);
+    }
+
+    // overloaded to float
+    inline void confirm(float expected, float actual, int line)
+    {
+        if (actual < (expected - 0.0001f) ||
+            actual > (expected + 0.0001f))
+        {
+            raiseConfirm(TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line));
+        }
+    }
+
+    // overloaded to double
+    inline void confirm(double expected, double actual, int line)
+    {
+        if (actual < (expected - 0.000001f) ||
+            actual > (expected + 0.000001f))
+        {
+            raiseConfirm(TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line));
+        }
+    }
+
+    // overloaded to long double
+    inline void confirm(long double expected, long double actual, int line)
+    {
+        if (actual < (expected - 0.000001) ||
+            actual > (expected + 0.000001))
+        {
+            raiseConfirm(TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line));
+        }
+    }
+
+    template <typename T>
+        requires(not std::convertible_to<T const &, std::string_view>)
+    void confirm(T const &expected, T const &actual, int line)
+    {
+        if (actual != expected)
+        {
+            raiseMismatch(expected, actual, line);
+        }
+    }
+
+    // Compares ranges of different types element by element, such as a
+    // std::array of expected values against a std::vector result.
+    template <typename ExpectedT, typename ActualT>
+        requires FormattableRange<ExpectedT> && FormattableRange<ActualT> &&
+                 (not std::same_as<ExpectedT, ActualT>)
+    void confirm(ExpectedT const &expected, ActualT const &actual, int line)
+    {
+        if (not std::ranges::equal(expected, actual))
         {
-            test->setFailed(ex.reason(), ex.line());
+            raiseMismatch(expected, actual, line);
         }
+    }
 
-        static void handleUnexpectedException(TestBase *test)
+    // Drives the loop behind CONFIRM_FASTER_THAN. The first iteration warms
+    // caches and is not timed. The median of the rest is compared with the
+    // budget, so a single preempted iteration cannot fail the test.
+    class FasterThan
+    {
+    public:
+        template <typename Rep, typename Period>
+        FasterThan(std::chrono::duration<Rep, Period> budget, int line, int iterations = 15)
+            : mBudget(std::chrono::duration_cast<std::chrono::nanoseconds>(budget)),
+              mLine(line),
+              mIterations(iterations)
         {
-            test->setFailed("Unexpected exception thrown.");
+            mSamples.reserve(iterations);
         }
 
-        static void handleTest(Test *test)
+        bool running()
         {
-            try
-            {
-                test->runEx();
-            }
-            catch (const ConfirmException &ex)
-            {
-                handleConfirmException(test, ex);
-            }
-            catch (const MissingException &ex)
-            {
-                handleMissingException(test, ex);
-            }
-            catch (...)
+            if (static_cast<int>(mSamples.size()) == mIterations)
             {
-                handleUnexpectedException(test);
+                confirmMedian();
+                return false;
             }
+            mIterationStart = std::chrono::steady_clock::now();
+            return true;
         }
 
-        static void handleSuite(TestSuite *suite, bool setup)
+        void next()
         {
-            try
-            {
-                if (setup)
-                {
-                    suite->suiteSetup();
-                }
-                else
-                {
-                    suite->suiteTeardown();
-                }
-            }
-            catch (const ConfirmException &ex)
+            auto elapsed = std::chrono::steady_clock::now() - mIterationStart;
+            if (mWarm)
             {
-                handleConfirmException(suite, ex);
+                mSamples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
             }
-            catch (...)
+            mWarm = true;
+        }
+
+    private:
+        void confirmMedian()
+        {
+            std::nth_element(mSamples.begin(), mSamples.begin() + mSamples.size() / 2, mSamples.end());
+            auto median = mSamples[mSamples.size() / 2];
+            if (median > mBudget)
             {
-                handleUnexpectedException(suite);
+                raiseConfirm(TDD::ActualConfirmException(
+                    "median faster than " + formatDuration(mBudget),
+                    "median " + formatDuration(median),
+                    mLine));
             }
         }
 
-        static bool isExpectedFailure(const Test *test)
+        std::chrono::nanoseconds mBudget;
+        int mLine;
+        int mIterations;
+        bool mWarm = false;
+        std::chrono::steady_clock::time_point mIterationStart;
+        std::vector<std::chrono::nanoseconds> mSamples;
+    };
+
+    // Ordered from slowest to fastest growth so classes can be compared.
+    enum class Complexity
+    {
+        O_1,
+        O_LOG_N,
+        O_N,
+        O_N_LOG_N,
+        O_N2,
+        O_N3
+    };
+
+    inline std::string_view complexityName(Complexity complexity)
+    {
+        switch (complexity)
         {
-            return (not test->expectedReason().empty()) && test->expectedReason() == test->reason();
+        case Complexity::O_1:
+            return "O(1)";
+        case Complexity::O_LOG_N:
+            return "O(log n)";
+        case Complexity::O_N:
+            return "O(n)";
+        case Complexity::O_N_LOG_N:
+            return "O(n log n)";
+        case Complexity::O_N2:
+            return "O(n^2)";
+        case Complexity::O_N3:
+            return "O(n^3)";
         }
+        return "O(?)";
+    }
 
-        static bool isMissedExpectedFailure(const Test *test)
+    inline double complexityGrowth(Complexity complexity, double n)
+    {
+        switch (complexity)
         {
-            return not test->expectedReason().empty();
+        case Complexity::O_1:
+            return 1.0;
+        case Complexity::O_LOG_N:
+            return std::log2(n);
+        case Complexity::O_N:
+            return n;
+        case Complexity::O_N_LOG_N:
+            return n * std::log2(n);
+        case Complexity::O_N2:
+            return n * n;
+        case Complexity::O_N3:
+            return n * n * n;
         }
+        return 1.0;
+    }
 
-        static void verifyPassedTest(const Test *test, TestCounters &counters)
+    // Fewer sizes leave too little to tell the growth classes apart.
+    constexpr std::size_t complexitySizesNeeded = 3;
+
+    // Least squares fit of times = overhead + coefficient * growth(sizes)
+    // for every class, so a constant cost such as a setup step does not
+    // make the growth look slower than it is. Timing noise is proportional
+    // to the time, so residuals are weighted by 1 / time^2 and small inputs
+    // count as much as large ones. Times are in nanoseconds and count as at
+    // least 1, since a clock too coarse to see the work reads 0. Neighbouring
+    // classes fit noisy data almost equally well, so the slowest growing
+    // class whose error is within a relative margin of the best fit wins.
+    inline Complexity fitComplexity(std::vector<double> const &sizes, std::vector<double> const &timesNs)
+    {
+        constexpr double margin = 0.5;
+        constexpr Complexity classes[] = {
+            Complexity::O_1, Complexity::O_LOG_N, Complexity::O_N,
+            Complexity::O_N_LOG_N, Complexity::O_N2, Complexity::O_N3};
+        if (sizes.size() < complexitySizesNeeded || sizes.size() != timesNs.size())
         {
-            if (isMissedExpectedFailure(test))
-            {
-                ++counters.missedFailures;
-                *outStream << "Missed expected failure\n"
-                           << "Test passed but was expected to fail." << std::endl;
-            }
-            else
-            {
-                ++counters.passed;
-                *outStream << "Passed" << std::endl;
-            }
+            return Complexity::O_1;
+        }
+        std::vector<double> times;
+        times.reserve(timesNs.size());
+        for (double time : timesNs)
+        {
+            times.push_back(std::max(1.0, time));
         }
 
-        static void verifyConfirmLocation(const TestBase *test, TestCounters &counters)
+        double errors[std::size(classes)];
+        double bestError = -1.0;
+        for (std::size_t c = 0; c < std::size(classes); ++c)
         {
-            ++counters.failed;
-            if (test->confirmLocation() != -1)
+            auto growth = [&](std::size_t i) { return complexityGrowth(classes[c], sizes[i]); };
+            auto weight = [&](std::size_t i) { return 1.0 / (times[i] * times[i]); };
+
+            double weights = 0.0;
+            double meanGrowth = 0.0;
+            double meanTime = 0.0;
+            for (std::size_t i = 0; i < sizes.size(); ++i)
             {
-                *outStream << "Failed confirm on line " << test->confirmLocation() << std::endl;
+                weights += weight(i);
+                meanGrowth += weight(i) * growth(i);
+                meanTime += weight(i) * times[i];
             }
-            else
+            meanGrowth /= weights;
+            meanTime /= weights;
+
+            double covariance = 0.0;
+            double variance = 0.0;
+            for (std::size_t i = 0; i < sizes.size(); ++i)
             {
-                *outStream << "Failed\n";
+                double deviation = growth(i) - meanGrowth;
+                covariance += weight(i) * deviation * (times[i] - meanTime);
+                variance += weight(i) * deviation * deviation;
+            }
+            // Time that falls as the input grows is no growth at all.
+            double coefficient = variance > 0.0 ? std::max(0.0, covariance / variance) : 0.0;
+            double overhead = meanTime - coefficient * meanGrowth;
+            if (overhead < 0.0)
+            {
+                // A negative overhead lets a faster growing class bend to fit
+                // slower data, so fit through the origin instead.
+                double timeGrowth = 0.0;
+                double growthSquared = 0.0;
+                for (std::size_t i = 0; i < sizes.size(); ++i)
+                {
+                    timeGrowth += weight(i) * times[i] * growth(i);
+                    growthSquared += weight(i) * growth(i) * growth(i);
+                }
+                overhead = 0.0;
+                coefficient = timeGrowth / growthSquared;
             }
-            *outStream << test->reason() << std::endl;
-        }
 
-        static void verifyFailedTest(const Test *test, TestCounters &counters)
-        {
-            if (isExpectedFailure(test))
+            double squares = 0.0;
+            for (std::size_t i = 0; i < sizes.size(); ++i)
             {
-                ++counters.passed;
-                *outStream << "Expected failure\n"
-                           << test->reason() << std::endl;
+                double residual = (times[i] - overhead - coefficient * growth(i)) / times[i];
+                squares += residual * residual;
             }
-            else
+            errors[c] = std::sqrt(squares / static_cast<double>(sizes.size()));
+            if (bestError < 0.0 || errors[c] < bestError)
             {
-                verifyConfirmLocation(test, counters);
+                bestError = errors[c];
             }
         }
 
-        static bool isSuiteFailed(TestSuite *suite, TestCounters &counters)
+        for (std::size_t c = 0; c < std::size(classes); ++c)
         {
-            if (not suite->passed())
+            // The small absolute term absorbs rounding when the fit is exact.
+            if (errors[c] <= bestError * (1.0 + margin) + 1e-9)
             {
-                verifyConfirmLocation(suite, counters);
-                return true;
+                return classes[c];
             }
-            ++counters.passed;
-            *outStream << "Passed" << std::endl;
-            return false;
         }
+        return Complexity::O_N3;
+    }
 
-        static void updateTestCounters(Test *test, TestCounters &counters)
+    // Times fn(size) for every size, keeping the fastest of a few runs per
+    // size, and fails when the fitted growth is worse than declared.
+    template <typename FunctionT, typename SizesT>
+    void confirmComplexity(FunctionT &&fn, SizesT const &sizes, Complexity declared, int line)
+    {
+        auto count = static_cast<std::size_t>(std::ranges::distance(sizes));
+        if (count < complexitySizesNeeded)
         {
-            if (test->passed())
-            {
-                verifyPassedTest(test, counters);
-            }
-            else
+            raiseConfirm(TDD::ActualConfirmException("at least " + std::to_string(complexitySizesNeeded) + " sizes",
+                                                     std::to_string(count) + " sizes", line));
+            return;
+        }
+        constexpr int repetitions = 5;
+        std::vector<double> inputSizes;
+        std::vector<double> times;
+        for (auto size : sizes)
+        {
+            auto fastest = std::chrono::nanoseconds::max();
+            for (int i = 0; i < repetitions; ++i)
             {
-                verifyFailedTest(test, counters);
+                auto start = std::chrono::steady_clock::now();
+                fn(size);
+                auto elapsed = std::chrono::steady_clock::now() - start;
+                fastest = std::min(fastest, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
             }
+            inputSizes.push_back(static_cast<double>(size));
+            times.push_back(static_cast<double>(fastest.count()));
         }
-    };
-
-    template <typename T>
-    class SetupAndTeardown : public T
-    {
 
-    public:
-        SetupAndTeardown(/* args */)
-        {
-            T::setup();
-        }
-        ~SetupAndTeardown()
+        Complexity fitted = fitComplexity(inputSizes, times);
+        if (fitted > declared)
         {
-            T::teardown();
+            raiseConfirm(TDD::ActualConfirmException(complexityName(declared), complexityName(fitted), line));
         }
-    };
+    }
 
-    template <typename T>
-    class TestSuiteSetupAndTeardown : public T, public TestSuite
+    // Read-only view of a whole file through mmap, so large files are
+    // compared in place instead of being copied into memory.
+    class MappedFile
     {
     public:
-        TestSuiteSetupAndTeardown(std::string_view name, std::string_view suite)
-            : TestSuite(name, suite) {}
+        explicit MappedFile(std::filesystem::path const &path)
+        {
+#if defined(__linux__)
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat info{};
+            if (fd == -1 || fstat(fd, &info) == -1)
+            {
+                if (fd != -1)
+                {
+                    ::close(fd);
+                }
+                return;
+            }
+            mOpen = true;
+            mSize = static_cast<std::size_t>(info.st_size);
+            if (mSize != 0)
+            {
+                void *data = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED)
+                {
+                    mOpen = false;
+                    mSize = 0;
+                }
+                else
+                {
+                    mData = static_cast<char const *>(data);
+                    madvise(data, mSize, MADV_SEQUENTIAL);
+                }
+            }
+            ::close(fd);
+#else
+            (void)path;
+#endif
+        }
 
-        void suiteSetup() override { T::setup(); }
+        ~MappedFile()
+        {
+#if defined(__linux__)
+            if (mData != nullptr)
+            {
+                munmap(const_cast<char *>(mData), mSize);
+            }
+#endif
+        }
 
-        void suiteTeardown() override { T::teardown(); }
-    };
+        MappedFile(MappedFile const &) = delete;
+        MappedFile &operator=(MappedFile const &) = delete;
 
-    inline void setOutStream(std::ostream &os)
-    {
-        outStream = &os;
-    }
+        bool isOpen() const { return mOpen; }
 
-    inline std::map<std::string, std::vector<Test *>> &getTests()
-    {
-        static std::map<std::string, std::vector<Test *>> tests;
+        std::string_view data() const { return {mData, mSize}; }
 
-        return tests;
-    }
+    private:
+        bool mOpen = false;
+        char const *mData = nullptr;
+        std::size_t mSize = 0;
+    };
 
-    inline std::map<std::string, std::vector<TestSuite *>> &getTestSuites()
+    // Offset of the first byte that differs, or the shorter size when one is
+    // a prefix of the other. Large blocks go through memcmp, which the C
+    // library vectorizes, and only the differing block is scanned byte by byte.
+    inline std::size_t firstDifference(std::string_view expected, std::string_view actual)
     {
-        static std::map<std::string, std::vector<TestSuite *>> suites;
-
-        return suites;
+        constexpr std::size_t blockSize = 4096;
+        std::size_t size = std::min(expected.size(), actual.size());
+        std::size_t offset = 0;
+        while (offset < size)
+        {
+            std::size_t block = std::min(blockSize, size - offset);
+            if (std::memcmp(expected.data() + offset, actual.data() + offset, block) != 0)
+            {
+                while (expected[offset] == actual[offset])
+                {
+                    ++offset;
+                }
+                return offset;
+            }
+            offset += block;
+        }
+        return size;
     }
 
-    inline void addTest(std::string_view suiteName, Test *test)
+    // A short, escaped excerpt around offset that starts at the beginning
+    // of its line when the line is not too long.
+    inline std::string snapshotExcerpt(std::string_view data, std::size_t offset)
     {
-        std::string name(suiteName);
-        if (not getTests().contains(name))
+        constexpr std::size_t before = 40;
+        constexpr std::size_t after = 40;
+        if (offset >= data.size())
         {
-            getTests().try_emplace(name, std::vector<Test *>());
+            return "<end of data>";
         }
-        getTests()[name].push_back(test);
-    }
+        std::size_t start = offset > before ? offset - before : 0;
+        if (offset != 0)
+        {
+            std::size_t newline = data.rfind('\n', offset - 1);
+            if (newline != std::string_view::npos && newline >= start)
+            {
+                start = newline + 1;
+            }
+        }
+        std::string_view excerpt = data.substr(start, offset - start + after);
 
-    inline void addTestSuite(std::string_view suiteName, TestSuite *suite)
-    {
-        std::string name(suiteName);
-        if (not getTestSuites().contains(name))
+        std::string result = start == 0 ? "\"" : "...\"";
+        for (char c : excerpt)
         {
-            getTestSuites().try_emplace(name, std::vector<TestSuite *>());
+            if (c == '\n')
+            {
+                result += "\\n";
+            }
+            else if (c == '\t')
+            {
+                result += "\\t";
+            }
+            else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f)
+            {
+                result += '?';
+            }
+            else
+            {
+                result += c;
+            }
         }
-        getTestSuites()[name].push_back(suite);
+        result += start + excerpt.size() < data.size() ? "\"..." : "\"";
+        return result;
     }
 
-    inline void runTests()
+    inline std::filesystem::path snapshotPath(std::string_view name)
     {
-        Runner::runAllTests();
+        return std::filesystem::path(getRunOptions().snapshotDirectory) / (std::string(name) + ".snap");
     }
 
-    inline void confirm(bool expected, bool actual, int line)
+#if defined(__linux__)
+    // Writes data and flushes it to disk before the file is renamed, so a
+    // crash cannot leave the rename on disk ahead of the contents.
+    inline bool writeDurably(std::filesystem::path const &path, std::string_view data)
     {
-        if (actual != expected)
+        int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1)
+        {
+            return false;
+        }
+        bool written = true;
+        while (written && not data.empty())
         {
-            throw TDD::BoolConfirmException(expected, line);
+            ssize_t length = ::write(fd, data.data(), data.size());
+            if (length == -1 && errno == EINTR)
+            {
+                continue;
+            }
+            written = length > 0;
+            if (written)
+            {
+                data.remove_prefix(static_cast<std::size_t>(length));
+            }
         }
+        written = written && fsync(fd) == 0;
+        return ::close(fd) == 0 && written;
     }
+#endif
 
-    // overloaded to string_view
-    inline void confirm(std::string_view expected, std::string_view actual, int line)
+    // Writes to a temporary file first and renames it over the golden, so
+    // readers never see a partially written snapshot.
+    inline bool writeSnapshot(std::string_view name, std::string_view data)
     {
-        if (actual != expected)
+        std::filesystem::path path = snapshotPath(name);
+        std::filesystem::path temporary = path;
+        temporary += ".tmp";
+        std::error_code error;
+        std::filesystem::create_directories(path.parent_path(), error);
+#if defined(__linux__)
+        if (not writeDurably(temporary, data))
+        {
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+#else
         {
-            throw TDD::ActualConfirmException(expected, actual, line);
+            std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+            file.write(data.data(), static_cast<std::streamsize>(data.size()));
+            if (not file.good())
+            {
+                return false;
+            }
         }
+#endif
+        std::filesystem::rename(temporary, path, error);
+        return not error;
     }
 
-    // overloaded to strings
-    inline void confirm(std::string const &expected, std::string const &actual, int line)
+    inline std::size_t lineNumberAt(std::string_view data, std::size_t offset)
     {
-        confirm(std::string_view(expected), std::string_view(actual), line);
+        return static_cast<std::size_t>(std::count(data.begin(), data.begin() + std::min(offset, data.size()), '\n')) + 1;
     }
 
-    // overloaded to float
-    inline void confirm(float expected, float actual, int line)
+    inline void confirmSnapshot(std::string_view name, std::string_view actual, int line)
     {
-        if (actual < (expected - 0.0001f) ||
-            actual > (expected + 0.0001f))
+        bool update = getRunOptions().updateSnapshots;
         {
-            throw TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line);
+            MappedFile golden(snapshotPath(name));
+            if (golden.isOpen())
+            {
+                std::string_view expected = golden.data();
+                std::size_t offset = firstDifference(expected, actual);
+                if (offset == expected.size() && offset == actual.size())
+                {
+                    return;
+                }
+                if (not update)
+                {
+                    std::string message(name);
+                    message += " differs at byte " + std::to_string(offset) +
+                               ", line " + std::to_string(lineNumberAt(expected, offset));
+                    raiseConfirm(TDD::SnapshotConfirmException(
+                        message, snapshotExcerpt(expected, offset), snapshotExcerpt(actual, offset), line));
+                    return;
+                }
+            }
+            else if (not update)
+            {
+                std::string message(name);
+                message += " is missing. Run with --update-snapshots to create it.";
+                raiseConfirm(TDD::SnapshotConfirmException(message, line));
+                return;
+            }
         }
-    }
 
-    // overloaded to double
-    inline void confirm(double expected, double actual, int line)
-    {
-        if (actual < (expected - 0.000001f) ||
-            actual > (expected + 0.000001f))
+        if (not writeSnapshot(name, actual))
         {
-            throw TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line);
+            std::string message = "unable to write " + snapshotPath(name).string();
+            raiseConfirm(TDD::SnapshotConfirmException(message, line));
+            return;
         }
+        *outStream << "Updated snapshot " << name << std::endl;
     }
 
-    // overloaded to long double
-    inline void confirm(long double expected, long double actual, int line)
+    // Drives STRESS: every thread waits behind a latch so they all start
+    // together, then runs the body iterations times. Yields are injected at
+    // random to shake out different interleavings.
+    class Stress
     {
-        if (actual < (expected - 0.000001) ||
-            actual > (expected + 0.000001))
+    public:
+        Stress(int threads, int iterations, int line)
+            : mThreads(threads), mIterations(iterations), mLine(line) {}
+
+        template <typename BodyT>
+        void operator*(BodyT body)
         {
-            throw TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line);
+            int capturedBefore = getThreadConfirms().count();
+            std::latch startLine(mThreads);
+            std::mutex failureMutex;
+            std::exception_ptr failure;
+            int thrown = 0;
+
+            auto start = std::chrono::steady_clock::now();
+            std::vector<std::thread> workers;
+            workers.reserve(mThreads);
+            for (int t = 0; t < mThreads; ++t)
+            {
+                workers.emplace_back([&, t]
+                {
+                    // A failed confirm ends the iteration instead of running
+                    // the rest of the body.
+                    ThreadConfirms::throwsOnThisThread() = true;
+                    std::minstd_rand random(static_cast<unsigned>(t) + 1);
+                    startLine.arrive_and_wait();
+                    for (int i = 0; i < mIterations; ++i)
+                    {
+                        if (random() % 4 == 0)
+                        {
+                            std::this_thread::yield();
+                        }
+                        try
+                        {
+                            body();
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard lock(failureMutex);
+                            if (thrown++ == 0)
+                            {
+                                failure = std::current_exception();
+                            }
+                        }
+                    }
+                });
+            }
+            for (auto &worker : workers)
+            {
+                worker.join();
+            }
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start);
+
+            int failures = thrown + getThreadConfirms().count() - capturedBefore;
+            printReport(elapsed, failures);
+            if (failure)
+            {
+                std::rethrow_exception(failure);
+            }
         }
-    }
 
-    template <typename T>
-    void confirm(T const &expected, T const &actual, int line)
-    {
-        if (actual != expected)
+    private:
+        void printReport(std::chrono::nanoseconds elapsed, int failures) const
         {
-            throw TDD::ActualConfirmException(std::to_string(expected), std::to_string(actual), line);
+            double operations = static_cast<double>(mThreads) * mIterations;
+            double seconds = std::max(1e-9, static_cast<double>(elapsed.count()) / 1e9);
+            *outStream << "Stress on line " << mLine << ": " << mThreads << " threads x "
+                       << mIterations << " iterations in " << formatDuration(elapsed) << " ("
+                       << static_cast<std::int64_t>(operations / seconds) << " per second)"
+                       << "\n    Failures: " << failures << std::endl;
         }
-    }
+
+        int mThreads;
+        int mIterations;
+        int mLine;
+    };
 } // namespace TDD
 
 // These macros generate unique names for tests using the line number:
@@ -657,6 +5313,44 @@ namespace TDD
     TDD_CLASS TDD_INSTANCE(testName, suiteName, #exceptionType);                                     \
     void TDD_CLASS::run()
 
+// The body of an async test is a coroutine, so it must contain at least
+// one co_await or co_return.
+#define TEST_ASYNC(testName)                      \
+    namespace                                     \
+    {                                             \
+        class TDD_CLASS : public TDD::AsyncTest   \
+        {                                         \
+        public:                                   \
+            TDD_CLASS(std::string_view name)      \
+                : AsyncTest(name, "") {}          \
+            TDD::Task runAsync() override;        \
+        };                                        \
+    } /* end of unnamed namespace */              \
+    TDD_CLASS TDD_INSTANCE(testName);             \
+    TDD::Task TDD_CLASS::runAsync()
+
+#define TEST_SUITE_ASYNC(testName, suiteName)                        \
+    namespace                                                        \
+    {                                                                \
+        class TDD_CLASS : public TDD::AsyncTest                      \
+        {                                                            \
+        public:                                                      \
+            TDD_CLASS(std::string_view name, std::string_view suite) \
+                : AsyncTest(name, suite) {}                          \
+            TDD::Task runAsync() override;                           \
+        };                                                           \
+    } /* end of unnamed namespace */                                 \
+    TDD_CLASS TDD_INSTANCE(testName, suiteName);                     \
+    TDD::Task TDD_CLASS::runAsync()
+
+#define TDD_TRACE_VAR_FINAL(line) tddTraceScope##line
+#define TDD_TRACE_VAR_RELAY(line) TDD_TRACE_VAR_FINAL(line)
+#define TDD_TRACE_VAR TDD_TRACE_VAR_RELAY(__LINE__)
+
+// Traces the rest of the enclosing scope as a span with the given name.
+#define TDD_TRACE_SCOPE(name) \
+    TDD::TraceScope TDD_TRACE_VAR(name);
+
 #define CONFIRM(expected, actual) \
     TDD::confirm(expected, actual, __LINE__);
 
@@ -665,4 +5359,30 @@ namespace TDD
 
 #define CONFIRM_TRUE(actual) \
     TDD::confirm(true, actual, __LINE__);
+
+// Runs the block that follows repeatedly and fails when the median
+// iteration takes longer than budget, a std::chrono duration.
+#define CONFIRM_FASTER_THAN(budget)                                  \
+    for (TDD::FasterThan tddFasterThan(budget, __LINE__);            \
+         tddFasterThan.running();                                    \
+         tddFasterThan.next())
+
+// Compares data with the golden file <snapshot directory>/<name>.snap.
+#define CONFIRM_SNAPSHOT(name, data) \
+    TDD::confirmSnapshot(name, data, __LINE__);
+
+// Runs the block that follows on the given number of threads at once, each
+// running it iterations times. Because the block becomes a lambda, it must
+// end with a semicolon:
+//     STRESS(4, 1000) { queue.push(1); };
+// A failed confirm in the block ends that iteration. On threads the test
+// starts itself, a failed confirm is recorded and returns, so the code after
+// it still runs.
+#define STRESS(threads, iterations) \
+    TDD::Stress(threads, iterations, __LINE__) * [&]()
+
+// Fails when fn(size), timed over the given sizes, grows faster than the
+// declared complexity, such as O_N or O_N_LOG_N.
+#define CONFIRM_COMPLEXITY(fn, sizes, complexity) \
+    TDD::confirmComplexity(fn, sizes, TDD::Complexity::complexity, __LINE__);
 #endif // TDD_TEST_H"
\ No newline at end of file
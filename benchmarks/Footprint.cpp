@@ -0,0 +1,91 @@
+// Measures the memory and time it takes to register a large number of tests.
+// It has its own main, so build it on its own:
+//     g++ -std=c++20 -O2 benchmarks/Footprint.cpp -o footprint
+//     ./footprint [test count]
+#include "../tests/EmptyTest.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::size_t gAllocatedBytes = 0;
+    std::size_t gAllocations = 0;
+}
+
+// Kept out of line so the optimizer does not pair the inlined free with
+// the standard operator new and warn about a mismatch.
+[[gnu::noinline]] void *operator new(std::size_t size)
+{
+    gAllocatedBytes += size;
+    ++gAllocations;
+    if (void *memory = std::malloc(size == 0 ? 1 : size))
+    {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+[[gnu::noinline]] void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+int main(int argc, const char **argv)
+{
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100'000;
+    constexpr std::size_t testsPerSuite = 100;
+
+    // Stands in for the string literals the test macros pass in, so it is
+    // not counted as registry memory.
+    std::vector<std::string> names;
+    names.reserve(count + count / testsPerSuite + 1);
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        names.push_back("Test number " + std::to_string(i) + " with a typically long descriptive name");
+    }
+    std::size_t firstSuite = names.size();
+    for (std::size_t i = 0; i <= count / testsPerSuite; ++i)
+    {
+        names.push_back("Suite " + std::to_string(i));
+    }
+
+    auto *tests = static_cast<EmptyTest *>(std::malloc(count * sizeof(EmptyTest)));
+
+    std::size_t bytesBefore = gAllocatedBytes;
+    std::size_t allocationsBefore = gAllocations;
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        new (tests + i) EmptyTest(names[i], names[firstSuite + i / testsPerSuite]);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    std::size_t registryBytes = gAllocatedBytes - bytesBefore;
+    std::size_t registryAllocations = gAllocations - allocationsBefore;
+
+    std::cout << "Registered " << count << " tests in " << TDD::getTests().size() << " suites\n"
+              << "sizeof(TestBase): " << sizeof(TDD::TestBase) << " bytes\n"
+              << "sizeof(Test): " << sizeof(TDD::Test) << " bytes\n"
+              << "Test objects: " << count * sizeof(EmptyTest) << " bytes\n"
+              << "Registry heap: " << registryBytes << " bytes in " << registryAllocations << " allocations\n"
+              << "Per test: " << (count * sizeof(EmptyTest) + registryBytes) / count << " bytes\n"
+              << "Registration time: "
+              << TDD::formatDuration(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)) << std::endl;
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        tests[i].~EmptyTest();
+    }
+    std::free(tests);
+    return 0;
+}
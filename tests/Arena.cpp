@@ -0,0 +1,39 @@
+#include "../Test.h"
+
+#include <string>
+
+TEST("Test arena stores a copy of the reason")
+{
+    TDD::ReasonArena arena;
+    std::string reason = "    Expected: 1\n    Actual  : 2";
+    std::string_view stored = arena.store(reason);
+    reason.assign(reason.size(), '#');
+    CONFIRM("    Expected: 1\n    Actual  : 2", stored);
+    CONFIRM_TRUE(arena.store("").empty());
+}
+
+TEST("Test arena reset keeps the first block")
+{
+    TDD::ReasonArena arena;
+    std::string_view first = arena.store("first");
+    arena.store(std::string(20 * 1024, 'x'));
+    CONFIRM(2, static_cast<int>(arena.blockCount()));
+
+    arena.reset();
+    CONFIRM(1, static_cast<int>(arena.blockCount()));
+    CONFIRM_TRUE(arena.store("again").data() == first.data());
+}
+
+TEST("Test arena release reuses the memory stored after the mark")
+{
+    TDD::ReasonArena arena;
+    std::string_view kept = arena.store("kept");
+    TDD::ReasonArena::Mark mark = arena.mark();
+    std::string_view released = arena.store("released");
+    arena.store(std::string(20 * 1024, 'x'));
+
+    arena.release(mark);
+    CONFIRM(1, static_cast<int>(arena.blockCount()));
+    CONFIRM_TRUE(arena.store("reused").data() == released.data());
+    CONFIRM("kept", kept);
+}
@@ -0,0 +1,94 @@
+#include "../Test.h"
+
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    TDD::Task waitTwice()
+    {
+        co_await TDD::sleepFor(5ms);
+        co_await TDD::sleepFor(5ms);
+    }
+
+    class SleepingTest : public TDD::AsyncTest
+    {
+    public:
+        SleepingTest()
+            : AsyncTest("Sleeping test", "Async timing") {}
+
+        TDD::Task runAsync() override
+        {
+            co_await TDD::sleepFor(20ms);
+        }
+    };
+}
+
+TEST_ASYNC("Test async can sleep without blocking")
+{
+    auto start = std::chrono::steady_clock::now();
+    co_await TDD::sleepFor(20ms);
+    CONFIRM_TRUE(std::chrono::steady_clock::now() - start >= 20ms);
+}
+
+TEST_ASYNC("Test async can await a future")
+{
+    std::future<int> result = std::async(std::launch::async, []
+    {
+        std::this_thread::sleep_for(10ms);
+        return 42;
+    });
+    int value = co_await result;
+    CONFIRM(42, value);
+}
+
+TEST_ASYNC("Test async can await another task")
+{
+    co_await waitTwice();
+}
+
+TEST_ASYNC("Test async confirm failure")
+{
+    std::string reason = "    Expected: 1\n";
+    reason += "    Actual  : 2";
+    setExpectedFailureReason(reason);
+
+    co_await TDD::sleepFor(10ms);
+    CONFIRM(1, 2);
+}
+
+TEST_ASYNC("Test async that throws unexpectedly")
+{
+    setExpectedFailureReason(
+        "Unexpected exception thrown.");
+
+    co_await TDD::sleepFor(1ms);
+    throw "Unexpected";
+}
+
+// The Runner reports the time an async test spent on the event loop,
+// which it measures before the test's result is collected.
+TEST("Test async test duration covers its time on the event loop")
+{
+    SleepingTest test;
+    test.start();
+    TDD::getEventLoop().run();
+    auto start = std::chrono::steady_clock::now();
+    test.run();
+    auto collected = std::chrono::steady_clock::now() - start;
+
+    CONFIRM_TRUE(test.taskDuration() >= 20ms);
+    CONFIRM_TRUE(collected < 20ms);
+}
+
+TEST("Test task duration is zero until it completes")
+{
+    TDD::Task task = waitTwice();
+    CONFIRM_TRUE(task.duration() == 0ns);
+    TDD::getEventLoop().post(task.handle());
+    TDD::getEventLoop().runUntil([&task] { return task.done(); });
+    CONFIRM_TRUE(task.duration() >= 10ms);
+}
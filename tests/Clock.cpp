@@ -0,0 +1,91 @@
+#include "../Test.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // If this was real code, it might retry a network call. The delay
+    // doubles after every failed attempt.
+    int connectWithRetry(int failuresBeforeSuccess)
+    {
+        auto delay = std::chrono::nanoseconds(1s);
+        int attempts = 1;
+        while (attempts <= failuresBeforeSuccess)
+        {
+            TDD::getClock().sleepFor(delay);
+            delay *= 2;
+            ++attempts;
+        }
+        return attempts;
+    }
+}
+
+TEST("Test virtual time runs backoff instantly")
+{
+    TDD::SetupAndTeardown<TDD::VirtualTime> time;
+    auto start = std::chrono::steady_clock::now();
+
+    int attempts = connectWithRetry(5);
+
+    CONFIRM(6, attempts);
+    CONFIRM_TRUE(time.elapsed() == 31s);
+    CONFIRM_TRUE(std::chrono::steady_clock::now() - start < 1s);
+}
+
+TEST("Test virtual time fires timers in deadline order")
+{
+    TDD::SetupAndTeardown<TDD::VirtualTime> time;
+    std::string fired;
+    time.callAfter(3s, [&] { fired += "c"; });
+    time.callAfter(1s, [&] { fired += "a"; });
+    time.callAfter(2s, [&] { fired += "b"; });
+
+    time.advance(2s);
+    CONFIRM("ab", fired);
+    CONFIRM_TRUE(time.elapsed() == 2s);
+
+    time.runUntilIdle();
+    CONFIRM("abc", fired);
+    CONFIRM_TRUE(time.elapsed() == 3s);
+}
+
+TEST("Test virtual time is restored after the test")
+{
+    {
+        TDD::SetupAndTeardown<TDD::VirtualTime> time;
+        CONFIRM_TRUE(&TDD::getClock() == &time);
+    }
+    CONFIRM_TRUE(dynamic_cast<TDD::SystemClock *>(&TDD::getClock()) != nullptr);
+}
+
+TEST("Test system clock timers can be scheduled from many threads")
+{
+    TDD::SystemClock clock;
+    std::atomic<int> fired = 0;
+    std::vector<std::jthread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&]
+        {
+            for (int i = 0; i < 1'000; ++i)
+            {
+                clock.callAfter(0ns, [&] { ++fired; });
+                if (i % 100 == 0)
+                {
+                    clock.sleepFor(0ns);
+                }
+            }
+        });
+    }
+    threads.clear();
+
+    clock.runUntilIdle();
+    CONFIRM(4'000, fired.load());
+    CONFIRM(0, static_cast<int>(clock.pendingTimers()));
+}
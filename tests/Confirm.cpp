@@ -1,5 +1,40 @@
 #include "../Test.h"
 
+#include <array>
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+#include <vector>
+
+enum class Color
+{
+	Red,
+	Green,
+	Blue
+};
+
+struct Point
+{
+	int x;
+	int y;
+
+	bool operator==(Point const &) const = default;
+};
+
+template <>
+struct TDD::Formatter<Point>
+{
+	static void format(std::string &out, Point const &value)
+	{
+		out += "Point(";
+		formatValue(out, value.x);
+		out += ", ";
+		formatValue(out, value.y);
+		out += ")";
+	}
+};
+
 bool isNegative(int value)
 {
 	return value < 0;
@@ -158,3 +193,64 @@ TEST("Test string confirm failure")
 	std::string expected = "def";
 	CONFIRM(expected, result);
 }
+
+TEST("Test container confirms")
+{
+	std::vector<int> result {1, 2, 3};
+	std::vector<int> expected {1, 2, 3};
+	CONFIRM(expected, result);
+
+	std::array<int, 3> expectedArray {1, 2, 3};
+	CONFIRM(expectedArray, result);
+
+	std::map<int, std::string> names {{1, "one"}};
+	CONFIRM(names, names);
+
+	std::optional<Point> point = Point {1, 2};
+	CONFIRM((std::optional<Point> {Point {1, 2}}), point);
+	CONFIRM(Color::Green, Color::Green);
+}
+
+TEST("Test vector confirm failure")
+{
+	std::string reason = "    Expected: [1, 2, 3]\n";
+	reason += "    Actual  : [1, 2, 4]";
+	setExpectedFailureReason(reason);
+
+	std::vector<int> result {1, 2, 4};
+	std::array<int, 3> expected {1, 2, 3};
+	CONFIRM(expected, result);
+}
+
+TEST("Test map confirm failure")
+{
+	std::string reason = "    Expected: {1: \"one\", 2: \"two\"}\n";
+	reason += "    Actual  : {1: \"one\"}";
+	setExpectedFailureReason(reason);
+
+	std::map<int, std::string> result {{1, "one"}};
+	std::map<int, std::string> expected {{1, "one"}, {2, "two"}};
+	CONFIRM(expected, result);
+}
+
+TEST("Test optional confirm failure")
+{
+	std::string reason = "    Expected: [2.5, nullopt]\n";
+	reason += "    Actual  : [nullopt, 0.1]";
+	setExpectedFailureReason(reason);
+
+	std::vector<std::optional<double>> result {std::nullopt, 0.1};
+	std::vector<std::optional<double>> expected {2.5, std::nullopt};
+	CONFIRM(expected, result);
+}
+
+TEST("Test tuple and user type confirm failure")
+{
+	std::string reason = "    Expected: (Point(1, 2), 1, \"a\")\n";
+	reason += "    Actual  : (Point(1, 3), 2, \"a\")";
+	setExpectedFailureReason(reason);
+
+	auto result = std::tuple(Point {1, 3}, Color::Blue, std::string("a"));
+	auto expected = std::tuple(Point {1, 2}, Color::Green, std::string("a"));
+	CONFIRM(expected, result);
+}
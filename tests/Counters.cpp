@@ -0,0 +1,19 @@
+#include "../Test.h"
+
+#include <vector>
+
+TEST("Test counter sampler reports software counters")
+{
+    TDD::CounterSampler sampler;
+    sampler.start();
+    std::vector<char> memory(1024 * 1024, 1);
+    TDD::ResourceCounters counters = sampler.stop();
+
+#if defined(__linux__)
+    CONFIRM_TRUE(counters.sampled);
+    CONFIRM_TRUE(counters.maxRssKb > 0);
+    CONFIRM(sampler.hasHardware(), counters.hasHardware());
+#else
+    CONFIRM_FALSE(counters.sampled);
+#endif
+}
@@ -0,0 +1,162 @@
+#include "../Test.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Version "B22*" is the GCC 12.2 data format.
+    constexpr std::uint32_t gcovVersion = 0x4232322a;
+
+    void appendHeader(std::string &data, std::uint32_t magic)
+    {
+        TDD::appendValue(data, magic);
+        TDD::appendValue(data, gcovVersion);
+        TDD::appendValue(data, std::uint32_t{0}); // stamp
+        TDD::appendValue(data, std::uint32_t{0}); // checksum
+    }
+
+    void appendString(std::string &data, std::string_view text)
+    {
+        TDD::appendValue(data, static_cast<std::uint32_t>(text.size() + 1));
+        data += text;
+        data += '\0';
+    }
+
+    void appendNotesFunction(std::string &data, std::uint32_t ident, std::string_view name, std::string_view file)
+    {
+        std::string record;
+        TDD::appendValue(record, ident);
+        TDD::appendValue(record, std::uint64_t{0}); // checksums
+        appendString(record, name);
+        TDD::appendValue(record, std::uint32_t{0}); // artificial
+        appendString(record, file);
+        TDD::appendValue(record, std::uint64_t{0}); // start line and column
+        TDD::appendValue(record, std::uint64_t{0}); // end line and column
+        TDD::appendValue(data, TDD::gcovFunctionTag);
+        TDD::appendValue(data, static_cast<std::uint32_t>(record.size()));
+        data += record;
+    }
+
+    void appendDataFunction(std::string &data, std::uint32_t ident, std::vector<std::uint64_t> const &counts)
+    {
+        TDD::appendValue(data, TDD::gcovFunctionTag);
+        TDD::appendValue(data, std::uint32_t{12});
+        TDD::appendValue(data, ident);
+        TDD::appendValue(data, std::uint64_t{0}); // checksums
+        TDD::appendValue(data, TDD::gcovArcCountsTag);
+        bool executed = false;
+        for (auto count : counts)
+        {
+            executed = executed || count != 0;
+        }
+        if (not executed)
+        {
+            // GCC leaves out counters that are all zero.
+            TDD::appendValue(data, -static_cast<std::int32_t>(counts.size() * sizeof(std::uint64_t)));
+            return;
+        }
+        TDD::appendValue(data, static_cast<std::uint32_t>(counts.size() * sizeof(std::uint64_t)));
+        for (auto count : counts)
+        {
+            TDD::appendValue(data, count);
+        }
+    }
+}
+
+TEST("Test coverage notes map functions to source files")
+{
+    std::string notes;
+    appendHeader(notes, TDD::gcovNotesMagic);
+    appendString(notes, "/work/build");
+    TDD::appendValue(notes, std::uint32_t{1}); // has unexecuted blocks
+    appendNotesFunction(notes, 7, "_Z3addii", "../src/Math.cpp");
+
+    auto functions = TDD::readCoverageNotes(notes);
+    CONFIRM(1, static_cast<int>(functions.size()));
+    CONFIRM("/work/src/Math.cpp", functions[7].file);
+    CONFIRM("_Z3addii", functions[7].name);
+}
+
+TEST("Test coverage data reports only executed functions")
+{
+    std::string data;
+    appendHeader(data, TDD::gcovDataMagic);
+    appendDataFunction(data, 1, {0, 0, 0});
+    appendDataFunction(data, 2, {0, 3});
+    appendDataFunction(data, 3, {0});
+
+    std::vector<std::uint32_t> executed = TDD::readExecutedFunctions(data);
+    CONFIRM(std::vector<std::uint32_t>{2}, executed);
+
+    // Data written by an older compiler uses another format and is ignored.
+    data[4] = '*';
+    data[5] = '3';
+    data[6] = '9';
+    data[7] = 'A';
+    CONFIRM_TRUE(TDD::readExecutedFunctions(data).empty());
+}
+
+TEST("Test coverage map selects tests that executed a changed file")
+{
+    TDD::CoverageMap map;
+    TDD::CoverageSet math {map.intern({"/work/src/Math.cpp", "_Z3addii"})};
+    TDD::CoverageSet text {map.intern({"/work/src/Text.cpp", "_Z4trimv"})};
+    map.beginSuite();
+    map.suiteCoverage() = text;
+    map.add("Suite", "Test add", math);
+    map.beginSuite();
+    map.add("", "Test trim", text);
+
+    std::string path = (std::filesystem::temp_directory_path() / "tdd_coverage_test.txt").string();
+    CONFIRM_TRUE(map.write(path));
+    TDD::CoverageMap loaded;
+    CONFIRM_TRUE(loaded.read(path));
+    std::filesystem::remove(path);
+    CONFIRM(2, static_cast<int>(loaded.size()));
+
+    auto changed = loaded.changedFunctions({"src/Math.cpp"});
+    CONFIRM_TRUE(loaded.isAffected("Suite", "Test add", changed));
+    CONFIRM_FALSE(loaded.isAffected("", "Test trim", changed));
+    CONFIRM_TRUE(loaded.isAffected("", "Test never recorded", changed));
+
+    // The suite setup coverage counts for the tests in the suite.
+    changed = loaded.changedFunctions({"Text.cpp"});
+    CONFIRM_TRUE(loaded.isAffected("Suite", "Test add", changed));
+    CONFIRM_TRUE(loaded.isAffected("", "Test trim", changed));
+
+    changed = loaded.changedFunctions({"ath.cpp"});
+    CONFIRM_FALSE(loaded.isAffected("Suite", "Test add", changed));
+}
+
+TEST("Test coverage recorded into a map read earlier keeps the other tests")
+{
+    TDD::CoverageMap map;
+    TDD::CoverageSet math {map.intern({"/work/src/Math.cpp", "_Z3addii"})};
+    TDD::CoverageSet text {map.intern({"/work/src/Text.cpp", "_Z4trimv"})};
+    map.beginSuite();
+    map.add("", "Test add", math);
+    map.add("", "Test trim", text);
+    std::string path = (std::filesystem::temp_directory_path() / "tdd_coverage_merge_test.txt").string();
+    CONFIRM_TRUE(map.write(path));
+
+    // A filtered run records only the test it ran.
+    TDD::CoverageMap merged;
+    CONFIRM_TRUE(merged.read(path));
+    merged.beginSuite();
+    merged.add("", "Test add", text);
+    CONFIRM_TRUE(merged.write(path));
+
+    TDD::CoverageMap loaded;
+    CONFIRM_TRUE(loaded.read(path));
+    std::filesystem::remove(path);
+    CONFIRM(2, static_cast<int>(loaded.size()));
+    auto changed = loaded.changedFunctions({"src/Math.cpp"});
+    CONFIRM_FALSE(loaded.isAffected("", "Test add", changed));
+    CONFIRM_FALSE(loaded.isAffected("", "Test trim", changed));
+    changed = loaded.changedFunctions({"src/Text.cpp"});
+    CONFIRM_TRUE(loaded.isAffected("", "Test add", changed));
+    CONFIRM_TRUE(loaded.isAffected("", "Test trim", changed));
+}
@@ -1,4 +1,4 @@
-#include "../Test.h"
+#include "EmptyTest.h"
 
 TEST("Test can be created")
 {
@@ -44,4 +44,35 @@ TEST_EX("Test that throws wrong type can be created", int)
         "Unexpected exception thrown.");
 
     throw "Wrong type";
-}
\ No newline at end of file
+}
+
+// Tests loaded from a shared object unregister when they are destroyed.
+TEST("Test that is destroyed is unregistered")
+{
+    std::string suiteName = "Dynamic registration";
+    {
+        EmptyTest test("Dynamic test", suiteName);
+        CONFIRM_TRUE(TDD::getTests().contains(suiteName));
+        CONFIRM(1, static_cast<int>(TDD::getTests()[suiteName].size()));
+    }
+    CONFIRM_FALSE(TDD::getTests().contains(suiteName));
+}
+
+// The registry key views a registered suite name, so it must move to a
+// remaining entry when the entry that owns the viewed name goes away.
+TEST("Test registry key outlives the test that owned its name")
+{
+    std::string firstSuiteName = "Rekeyed registration";
+    std::string secondSuiteName = firstSuiteName;
+    auto first = std::make_unique<EmptyTest>("First dynamic test", firstSuiteName);
+    EmptyTest second("Second dynamic test", secondSuiteName);
+    auto found = TDD::getTests().find(secondSuiteName);
+    CONFIRM_TRUE(found->first.data() == firstSuiteName.data());
+
+    first.reset();
+    firstSuiteName.assign(firstSuiteName.size(), '#');
+    found = TDD::getTests().find(secondSuiteName);
+    CONFIRM_TRUE(found != TDD::getTests().end());
+    CONFIRM_TRUE(found->first.data() == secondSuiteName.data());
+    CONFIRM(1, static_cast<int>(found->second.size()));
+}
@@ -0,0 +1,19 @@
+#ifndef TDD_EMPTY_TEST_H
+#define TDD_EMPTY_TEST_H
+
+#include "../Test.h"
+
+#include <string_view>
+
+// A test with an empty body, created at run time by the tests and
+// benchmarks that exercise the registry and the stored results.
+class EmptyTest : public TDD::Test
+{
+public:
+    EmptyTest(std::string_view name, std::string_view suiteName)
+        : Test(name, suiteName) {}
+
+    void run() override {}
+};
+
+#endif // TDD_EMPTY_TEST_H
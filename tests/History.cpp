@@ -0,0 +1,77 @@
+#include "EmptyTest.h"
+
+#include <chrono>
+#include <filesystem>
+#include <sstream>
+#include <string>
+
+TEST("Test history keeps rows of every run")
+{
+    std::string path = (std::filesystem::temp_directory_path() / "tdd_history_test.bin").string();
+    std::filesystem::remove(path);
+    {
+        EmptyTest test("Recorded test", "History suite");
+        TDD::History history;
+        CONFIRM_TRUE(history.open(path));
+        for (int run = 1; run <= 3; ++run)
+        {
+            history.beginRun();
+            test.setDuration(std::chrono::milliseconds(run));
+            history.append(&test, TDD::TestOutcome::Passed);
+        }
+    }
+
+    TDD::History history;
+    CONFIRM_TRUE(history.open(path));
+    CONFIRM(3u, history.runs());
+
+    auto const *recorded = history.find("History suite", "Recorded test");
+    CONFIRM_TRUE(recorded != nullptr);
+    CONFIRM(3, static_cast<int>(recorded->rows.size()));
+    CONFIRM(3'000'000LL, static_cast<long long>(recorded->rows.back().durationNs));
+
+    history.close();
+    std::filesystem::remove(path);
+}
+
+TEST("Test history trend names the suite and skips tests outside the window")
+{
+    std::string path = (std::filesystem::temp_directory_path() / "tdd_history_trend_test.bin").string();
+    std::filesystem::remove(path);
+    {
+        EmptyTest recent("Trend test", "History suite");
+        EmptyTest dropped("Trend test dropped", "");
+        TDD::History history;
+        CONFIRM_TRUE(history.open(path));
+        for (int run = 1; run <= 3; ++run)
+        {
+            history.beginRun();
+            recent.setDuration(std::chrono::milliseconds(run));
+            history.append(&recent, TDD::TestOutcome::Passed);
+            if (run == 1)
+            {
+                history.append(&dropped, TDD::TestOutcome::Passed);
+            }
+        }
+    }
+
+    TDD::History history;
+    CONFIRM_TRUE(history.open(path));
+    TDD::HistoryReport report(history, 2);
+    std::ostringstream trend;
+    std::ostream *previous = TDD::outStream;
+    TDD::outStream = &trend;
+    report.printTrend("Trend test");
+    TDD::outStream = previous;
+    history.close();
+    std::filesystem::remove(path);
+
+    std::string expected = "------------ History: History suite/Trend test\n";
+    for (int run = 2; run <= 3; ++run)
+    {
+        expected += "    Run " + std::to_string(run) + ": " +
+                    TDD::formatDuration(std::chrono::milliseconds(run)) + "  " +
+                    std::string(TDD::outcomeName(TDD::TestOutcome::Passed)) + "\n";
+    }
+    CONFIRM(expected, trend.str());
+}
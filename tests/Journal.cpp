@@ -0,0 +1,194 @@
+#include "EmptyTest.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    std::string journalTestPath()
+    {
+        return (std::filesystem::temp_directory_path() / "tdd_journal_test.bin").string();
+    }
+
+    int countRecords(std::string const &path)
+    {
+        int count = 0;
+        TDD::RecordFile file;
+        file.open(path, "TESTJRNL", true, [&](std::string_view)
+        {
+            ++count;
+        });
+        return count;
+    }
+
+    // Turns on --resume for one test and restores the Runner's options after.
+    class ResumeOptions
+    {
+    public:
+        void setup()
+        {
+            mSaved = TDD::getRunOptions();
+            TDD::getRunOptions() = {};
+            TDD::getRunOptions().resume = true;
+        }
+
+        void teardown()
+        {
+            TDD::getRunOptions() = std::move(mSaved);
+        }
+
+    private:
+        TDD::RunOptions mSaved;
+    };
+}
+
+TEST("Test record file keeps appended records")
+{
+    std::string path = journalTestPath();
+    {
+        TDD::RecordFile file;
+        CONFIRM_TRUE(file.open(path, "TESTJRNL", false, [](std::string_view) {}));
+        CONFIRM_TRUE(file.append("first"));
+        CONFIRM_TRUE(file.append("second"));
+    }
+    CONFIRM(2, countRecords(path));
+    std::filesystem::remove(path);
+}
+
+TEST("Test record file discards a torn tail")
+{
+    std::string path = journalTestPath();
+    {
+        TDD::RecordFile file;
+        file.open(path, "TESTJRNL", false, [](std::string_view) {});
+        file.append("complete");
+    }
+    {
+        // A record header that promises more payload than was written.
+        std::ofstream torn(path, std::ios::binary | std::ios::app);
+        torn.write("\x40\x00\x00\x00\x01\x02\x03\x04torn", 12);
+    }
+
+    TDD::RecordFile file;
+    int count = 0;
+    file.open(path, "TESTJRNL", true, [&](std::string_view payload)
+    {
+        CONFIRM("complete", std::string(payload));
+        ++count;
+    });
+    CONFIRM(1, count);
+    CONFIRM(12, static_cast<int>(file.discarded()));
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST("Test record file does not count the padding of a file left open")
+{
+    std::string path = journalTestPath();
+    std::string copyPath = path + ".copy";
+    {
+        TDD::RecordFile file;
+        file.open(path, "TESTJRNL", false, [](std::string_view) {});
+        file.append("first");
+        file.append("second");
+        file.sync();
+        // The copy is what a crash leaves behind: the records followed by
+        // the zeros of the unused part of the mapping.
+        std::filesystem::copy_file(path, copyPath, std::filesystem::copy_options::overwrite_existing);
+    }
+    CONFIRM_TRUE(std::filesystem::file_size(copyPath) > std::filesystem::file_size(path));
+
+    TDD::RecordFile file;
+    int count = 0;
+    file.open(copyPath, "TESTJRNL", true, [&](std::string_view)
+    {
+        ++count;
+    });
+    CONFIRM(2, count);
+    CONFIRM(0, static_cast<int>(file.discarded()));
+    file.close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(copyPath);
+}
+
+TEST("Test record file discards a record whose checksum does not match")
+{
+    std::string path = journalTestPath();
+    {
+        TDD::RecordFile file;
+        file.open(path, "TESTJRNL", false, [](std::string_view) {});
+        file.append("first");
+        file.append("second");
+    }
+    {
+        // Changes the last payload byte of the second record.
+        std::fstream corrupt(path, std::ios::binary | std::ios::in | std::ios::out);
+        corrupt.seekp(-1, std::ios::end);
+        corrupt.put('X');
+    }
+
+    TDD::RecordFile file;
+    int count = 0;
+    file.open(path, "TESTJRNL", true, [&](std::string_view payload)
+    {
+        CONFIRM("first", std::string(payload));
+        ++count;
+    });
+    CONFIRM(1, count);
+    // The length and checksum header followed by "second".
+    CONFIRM(14, static_cast<int>(file.discarded()));
+    file.close();
+    std::filesystem::remove(path);
+}
+
+TEST("Test resume skips the tests already in the journal")
+{
+    TDD::SetupAndTeardown<ResumeOptions> options;
+    std::string path = journalTestPath();
+    EmptyTest finished("Finished test", "");
+    EmptyTest interrupted("Interrupted test", "");
+    finished.setFailed("Reason kept in the journal", 42);
+    {
+        TDD::Journal journal;
+        CONFIRM_TRUE(journal.open(path, false));
+        journal.append(&finished, TDD::TestOutcome::Failed);
+    }
+
+    TDD::Journal journal;
+    CONFIRM_TRUE(journal.open(path, true));
+    CONFIRM(1, static_cast<int>(journal.size()));
+    CONFIRM(0, static_cast<int>(journal.discarded()));
+    CONFIRM_FALSE(TDD::detail::needsRun(&finished, journal));
+    CONFIRM_TRUE(TDD::detail::needsRun(&interrupted, journal));
+
+    TDD::JournalEntry const *entry = journal.find(&finished);
+    CONFIRM_TRUE(entry != nullptr);
+    CONFIRM(TDD::TestOutcome::Failed, entry->outcome);
+    CONFIRM(42, entry->confirmLocation);
+    CONFIRM("Reason kept in the journal", entry->reason);
+    journal.close();
+    std::filesystem::remove(path);
+}
+
+TEST("Test resumed results are reported with the new results")
+{
+    TDD::JournalEntry entry{TDD::TestOutcome::Failed, 0, 7, "Journaled reason"};
+    TDD::TestCounters counters;
+    std::ostringstream report;
+    std::ostream *previous = TDD::outStream;
+    TDD::outStream = &report;
+    TDD::detail::reportJournaled(entry, counters);
+    counters.add(TDD::TestOutcome::Passed);
+    TDD::detail::printTestSummary(counters);
+    TDD::outStream = previous;
+
+    CONFIRM("Resumed from journal: Failed confirm on line 7\n"
+            "Journaled reason\n"
+            "-------------------------\n"
+            "Tests passed: 1\n"
+            "Tests failed: 1\n"
+            "Resumed from journal: 1\n",
+            report.str());
+}
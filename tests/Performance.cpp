@@ -0,0 +1,113 @@
+#include "../Test.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace
+{
+    volatile long gSink = 0;
+
+    void linearWork(std::size_t n)
+    {
+        long sum = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            sum += static_cast<long>(i);
+        }
+        gSink = sum;
+    }
+
+    void quadraticWork(std::size_t n)
+    {
+        long sum = 0;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            for (std::size_t j = 0; j < n; ++j)
+            {
+                sum += static_cast<long>(i ^ j);
+            }
+        }
+        gSink = sum;
+    }
+
+    // Synthetic timings in nanoseconds of growth(n) plus a fixed overhead,
+    // scaled so the largest size takes a millisecond, with a repeating
+    // +/-0.5% wobble standing in for measurement noise.
+    std::vector<double> syntheticTimes(std::vector<double> const &sizes, TDD::Complexity complexity, double overhead)
+    {
+        std::vector<double> times;
+        double largest = TDD::complexityGrowth(complexity, sizes.back());
+        for (std::size_t i = 0; i < sizes.size(); ++i)
+        {
+            double wobble = i % 2 == 0 ? 1.005 : 0.995;
+            times.push_back((overhead + TDD::complexityGrowth(complexity, sizes[i]) / largest) * wobble * 1e6);
+        }
+        return times;
+    }
+}
+
+TEST("Test faster than confirm passes within budget")
+{
+    CONFIRM_FASTER_THAN(std::chrono::milliseconds(100))
+    {
+        linearWork(1000);
+    }
+}
+
+TEST("Test complexity fit finds every class despite a fixed overhead")
+{
+    std::vector<double> sizes{1'000, 2'000, 4'000, 8'000, 16'000, 32'000};
+    constexpr TDD::Complexity classes[] = {
+        TDD::Complexity::O_LOG_N, TDD::Complexity::O_N, TDD::Complexity::O_N_LOG_N,
+        TDD::Complexity::O_N2, TDD::Complexity::O_N3};
+    for (auto complexity : classes)
+    {
+        for (double overhead : {0.0, 0.2, 1.0})
+        {
+            auto fitted = TDD::fitComplexity(sizes, syntheticTimes(sizes, complexity, overhead));
+            CONFIRM(TDD::complexityName(complexity), TDD::complexityName(fitted));
+        }
+    }
+}
+
+TEST("Test complexity fit finds constant time")
+{
+    std::vector<double> sizes{1'000, 2'000, 4'000, 8'000, 16'000, 32'000};
+    std::vector<double> times{5.05, 4.95, 5.05, 4.95, 5.05, 4.95};
+    CONFIRM(TDD::complexityName(TDD::Complexity::O_1), TDD::complexityName(TDD::fitComplexity(sizes, times)));
+}
+
+TEST("Test complexity fit counts a time too short to measure as 1 ns")
+{
+    std::vector<double> sizes{1'000, 2'000, 4'000, 8'000, 16'000, 32'000};
+    std::vector<double> times{0, 0, 0, 0, 0, 0};
+    CONFIRM(TDD::complexityName(TDD::Complexity::O_1), TDD::complexityName(TDD::fitComplexity(sizes, times)));
+}
+
+TEST("Test complexity confirm needs at least three sizes")
+{
+    std::string reason = "    Expected: at least 3 sizes\n";
+    reason += "    Actual  : 2 sizes";
+    setExpectedFailureReason(reason);
+
+    std::vector<std::size_t> sizes{1'000, 2'000};
+    CONFIRM_COMPLEXITY(linearWork, sizes, O_N);
+}
+
+TEST("Test complexity confirm passes for linear work")
+{
+    std::vector<std::size_t> sizes{10'000, 40'000, 160'000, 640'000, 2'560'000, 10'240'000};
+    CONFIRM_COMPLEXITY(linearWork, sizes, O_N);
+}
+
+TEST("Test complexity confirm failure for quadratic work")
+{
+    std::string reason = "    Expected: O(n)\n";
+    reason += "    Actual  : O(n^2)";
+    setExpectedFailureReason(reason);
+
+    std::vector<std::size_t> sizes{125, 250, 500, 1'000, 2'000, 4'000};
+    CONFIRM_COMPLEXITY(quadraticWork, sizes, O_N);
+}
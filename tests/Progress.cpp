@@ -0,0 +1,73 @@
+#include "../Test.h"
+
+#include <sstream>
+#include <string>
+#include <string_view>
+
+void printFromAnotherUnit(std::string_view text);
+
+TEST("Test progress is not shown when output is not a terminal")
+{
+    std::ostringstream output;
+    CONFIRM_FALSE(TDD::ProgressDisplay::isTerminal(output));
+}
+
+TEST("Test progress keeps output lines whole")
+{
+    std::ostringstream terminal;
+    TDD::ProgressDisplay progress;
+    progress.start(terminal, 2, 0, 2);
+    CONFIRM_TRUE(progress.isActive());
+
+    progress.testStarted(this);
+    progress.stream() << "first line" << std::endl;
+    progress.testFinished(TDD::TestOutcome::Passed, -1);
+    progress.stream() << "partial";
+    progress.stop();
+    CONFIRM_FALSE(progress.isActive());
+
+    std::string text = terminal.str();
+    CONFIRM_TRUE(text.find("\r\x1b[Kfirst line\n") != std::string::npos);
+    CONFIRM_TRUE(text.find("[0/2] 0 passed, 0 failed") != std::string::npos);
+    CONFIRM_TRUE(text.ends_with("\r\x1b[Kpartial"));
+}
+
+// The status line counts outcomes the way the summary after the run does.
+TEST("Test progress counts outcomes like the summary")
+{
+    std::ostringstream terminal;
+    TDD::ProgressDisplay progress;
+    progress.start(terminal, 5, 0, 5);
+    progress.testFinished(TDD::TestOutcome::Passed, -1);
+    progress.testFinished(TDD::TestOutcome::ExpectedFailure, -1);
+    progress.testFinished(TDD::TestOutcome::Failed, -1);
+    progress.testFinished(TDD::TestOutcome::MissedFailure, -1);
+    progress.testFinished(TDD::TestOutcome::Quarantined, -1);
+    std::string status = progress.statusLine();
+    progress.stop();
+
+    CONFIRM_TRUE(status.starts_with("[5/5] 2 passed, 1 failed, 1 missed, 1 quarantined"));
+}
+
+// Output redirected in one translation unit must be redirected in all of
+// them, or it is printed over the status line.
+TEST("Test progress clears the status line before output from every unit")
+{
+    std::ostringstream terminal;
+    TDD::ProgressDisplay progress;
+    progress.start(terminal, 1, 0, 1);
+    std::ostream *previous = TDD::outStream;
+    TDD::outStream = &progress.stream();
+    printFromAnotherUnit("from another unit");
+    TDD::outStream = previous;
+    progress.stop();
+
+    std::string text = terminal.str();
+    CONFIRM_TRUE(text.find("\r\x1b[Kfrom another unit\n") != std::string::npos);
+    for (std::size_t end = text.find('\n'); end != std::string::npos; end = text.find('\n', end + 1))
+    {
+        std::size_t cleared = text.rfind("\r\x1b[K", end);
+        CONFIRM_TRUE(cleared != std::string::npos);
+        CONFIRM_FALSE(text[cleared + 4] == '[');
+    }
+}
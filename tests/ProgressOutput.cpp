@@ -0,0 +1,10 @@
+#include "../Test.h"
+
+#include <string_view>
+
+// Prints from a translation unit other than the one that redirects the
+// output, as the suite headers and stress reports do.
+void printFromAnotherUnit(std::string_view text)
+{
+    *TDD::outStream << text << std::endl;
+}
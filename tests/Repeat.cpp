@@ -0,0 +1,187 @@
+#include "EmptyTest.h"
+
+#include <chrono>
+#include <cmath>
+#include <sstream>
+#include <string>
+
+using namespace std::chrono_literals;
+
+namespace
+{
+    // Fails on every other run, with the run number in its reason.
+    class AlternatingTest : public TDD::Test
+    {
+    public:
+        AlternatingTest()
+            : Test("Alternating test", "Repeated runs") {}
+
+        void run() override
+        {
+            ++mRuns;
+            if (mRuns % 2 == 0)
+            {
+                CONFIRM(0, mRuns);
+            }
+        }
+
+    private:
+        int mRuns = 0;
+    };
+
+    // Runs the test the way the Runner does, without the tracing and counters.
+    void runOnce(TDD::Test *test)
+    {
+        test->resetResult();
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            test->runEx();
+        }
+        catch (TDD::ConfirmException const &ex)
+        {
+            test->setFailed(ex.reason(), ex.line());
+        }
+        test->setDuration(std::chrono::steady_clock::now() - start);
+    }
+
+    // Gives a test its own run options and restores the Runner's after.
+    class IsolatedOptions
+    {
+    public:
+        void setup()
+        {
+            mSaved = TDD::getRunOptions();
+            TDD::getRunOptions() = {};
+        }
+
+        void teardown()
+        {
+            TDD::getRunOptions() = std::move(mSaved);
+        }
+
+    private:
+        TDD::RunOptions mSaved;
+    };
+}
+
+TEST("Test repeat reports the pass rate and first failure of a flaky test")
+{
+    TDD::SetupAndTeardown<IsolatedOptions> options;
+    TDD::getRunOptions().repeat = 10;
+    AlternatingTest test;
+
+    TDD::RepeatStats stats = TDD::detail::repeatTest(&test, runOnce);
+    CONFIRM(10, stats.runs);
+    CONFIRM(5, stats.succeeded);
+    CONFIRM(2, stats.firstFailure);
+    CONFIRM_TRUE(stats.flaky());
+    CONFIRM_FALSE(test.passed());
+    CONFIRM("    Expected: 0\n    Actual  : 2", test.reason());
+    CONFIRM(TDD::TestOutcome::Failed, TDD::detail::outcomeOf(&test));
+}
+
+TEST("Test repeat of a passing test is not flaky")
+{
+    TDD::SetupAndTeardown<IsolatedOptions> options;
+    TDD::getRunOptions().repeat = 5;
+    EmptyTest test("Passing test", "Repeated runs");
+
+    TDD::RepeatStats stats = TDD::detail::repeatTest(&test, runOnce);
+    CONFIRM(5, stats.runs);
+    CONFIRM(5, stats.succeeded);
+    CONFIRM(0, stats.firstFailure);
+    CONFIRM_FALSE(stats.flaky());
+    CONFIRM_TRUE(test.passed());
+}
+
+TEST("Test until fail stops at the first failure")
+{
+    TDD::SetupAndTeardown<IsolatedOptions> options;
+    TDD::getRunOptions().untilFail = true;
+    AlternatingTest test;
+
+    TDD::RepeatStats stats = TDD::detail::repeatTest(&test, runOnce);
+    CONFIRM(2, stats.runs);
+    CONFIRM(1, stats.succeeded);
+    CONFIRM(2, stats.firstFailure);
+    CONFIRM_FALSE(test.passed());
+}
+
+TEST("Test quarantined failure is not counted as failed")
+{
+    TDD::SetupAndTeardown<IsolatedOptions> options;
+    TDD::getRunOptions().repeat = 2;
+    TDD::getRunOptions().quarantine.insert("Alternating test");
+    AlternatingTest test;
+    TDD::detail::repeatTest(&test, runOnce);
+
+    TDD::TestOutcome outcome = TDD::detail::outcomeOf(&test);
+    CONFIRM(TDD::TestOutcome::Quarantined, outcome);
+    TDD::TestCounters counters;
+    counters.add(outcome);
+    CONFIRM(0, counters.failed);
+    CONFIRM(1, counters.quarantined);
+}
+
+TEST("Test counters keep each outcome apart")
+{
+    TDD::TestCounters counters;
+    counters.add(TDD::TestOutcome::Passed);
+    counters.add(TDD::TestOutcome::ExpectedFailure);
+    counters.add(TDD::TestOutcome::Failed);
+    counters.add(TDD::TestOutcome::MissedFailure);
+    counters.add(TDD::TestOutcome::Quarantined);
+    CONFIRM(2, counters.passed);
+    CONFIRM(1, counters.failed);
+    CONFIRM(1, counters.missedFailures);
+    CONFIRM(1, counters.quarantined);
+}
+
+TEST("Test filter selects tests whose name contains it")
+{
+    TDD::SetupAndTeardown<IsolatedOptions> options;
+    AlternatingTest test;
+    CONFIRM_TRUE(TDD::detail::isSelected(&test));
+
+    TDD::getRunOptions().filter = "Alternating";
+    CONFIRM_TRUE(TDD::detail::isSelected(&test));
+
+    TDD::getRunOptions().filter = "alternating";
+    CONFIRM_FALSE(TDD::detail::isSelected(&test));
+}
+
+TEST("Test repeat stats keep the mean and standard deviation")
+{
+    TDD::RepeatStats stats;
+    for (auto duration : {100ns, 200ns, 300ns, 400ns})
+    {
+        ++stats.runs;
+        stats.addDuration(duration);
+    }
+    CONFIRM_TRUE(std::abs(stats.meanNs - 250.0) < 1e-9);
+    CONFIRM_TRUE(std::abs(stats.standardDeviationNs() - std::sqrt(50000.0 / 3.0)) < 1e-9);
+}
+
+TEST("Test repeat count must be a whole number of at least 1")
+{
+    TDD::SetupAndTeardown<IsolatedOptions> options;
+    int count = 0;
+    CONFIRM_TRUE(TDD::parseCount("12", 1, count));
+    CONFIRM(12, count);
+    CONFIRM_FALSE(TDD::parseCount("0", 1, count));
+    CONFIRM_FALSE(TDD::parseCount("-3", 1, count));
+    CONFIRM_FALSE(TDD::parseCount("5x", 1, count));
+    CONFIRM_FALSE(TDD::parseCount("", 1, count));
+    CONFIRM(12, count);
+
+    std::ostringstream usage;
+    std::ostream *previous = TDD::outStream;
+    TDD::outStream = &usage;
+    const char *argv[] = {"main", "--repeat", "0"};
+    bool parsed = TDD::parseArguments(3, argv);
+    TDD::outStream = previous;
+    CONFIRM_FALSE(parsed);
+    CONFIRM("--repeat needs a count of at least 1, not 0\n", usage.str());
+    CONFIRM(1, TDD::getRunOptions().repeat);
+}
@@ -0,0 +1,97 @@
+#include "../Test.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+namespace
+{
+    // Points the snapshot directory at a temporary directory for one test
+    // and restores the update flag the test may set.
+    class TempSnapshots
+    {
+    public:
+        void setup()
+        {
+            mPrevious = TDD::getRunOptions().snapshotDirectory;
+            mPreviousUpdate = TDD::getRunOptions().updateSnapshots;
+            mDirectory = std::filesystem::temp_directory_path() / "tdd_snapshot_test";
+            TDD::getRunOptions().snapshotDirectory = mDirectory.string();
+        }
+
+        void teardown()
+        {
+            TDD::getRunOptions().snapshotDirectory = mPrevious;
+            TDD::getRunOptions().updateSnapshots = mPreviousUpdate;
+            std::filesystem::remove_all(mDirectory);
+        }
+
+    private:
+        std::string mPrevious;
+        bool mPreviousUpdate = false;
+        std::filesystem::path mDirectory;
+    };
+
+    std::string report()
+    {
+        std::string result;
+        for (int i = 0; i < 1000; ++i)
+        {
+            result += "row " + std::to_string(i) + "\n";
+        }
+        return result;
+    }
+}
+
+TEST("Test snapshot confirms matching data")
+{
+    TDD::SetupAndTeardown<TempSnapshots> snapshots;
+    TDD::writeSnapshot("report", report());
+
+    CONFIRM_SNAPSHOT("report", report());
+}
+
+TEST("Test snapshot confirm failure")
+{
+    std::string reason = "    Snapshot: report differs at byte 3895, line 501\n";
+    reason += "    Expected: ...\"row 500\\nrow 501\\nrow 502\\nrow 503\\nrow 504\\nrow 5\"...\n";
+    reason += "    Actual  : ...\"row 5OO\\nrow 501\\nrow 502\\nrow 503\\nrow 504\\nrow 5\"...";
+    setExpectedFailureReason(reason);
+
+    TDD::SetupAndTeardown<TempSnapshots> snapshots;
+    TDD::writeSnapshot("report", report());
+
+    std::string changed = report();
+    changed.replace(changed.find("row 500"), 7, "row 5OO");
+    CONFIRM_SNAPSHOT("report", changed);
+}
+
+TEST("Test snapshot confirm failure when golden is missing")
+{
+    setExpectedFailureReason(
+        "    Snapshot: report is missing. Run with --update-snapshots to create it.");
+
+    TDD::SetupAndTeardown<TempSnapshots> snapshots;
+    CONFIRM_SNAPSHOT("report", report());
+}
+
+TEST("Test snapshot update rewrites a changed golden")
+{
+    TDD::SetupAndTeardown<TempSnapshots> snapshots;
+    TDD::writeSnapshot("report", report());
+    std::string changed = report();
+    changed.replace(changed.find("row 500"), 7, "row 5OO");
+
+    TDD::getRunOptions().updateSnapshots = true;
+    CONFIRM_SNAPSHOT("report", changed);
+
+    std::ifstream golden(TDD::snapshotPath("report"), std::ios::binary);
+    std::ostringstream contents;
+    contents << golden.rdbuf();
+    CONFIRM_TRUE(contents.str() == changed);
+    CONFIRM_FALSE(std::filesystem::exists(TDD::snapshotPath("report").string() + ".tmp"));
+
+    TDD::getRunOptions().updateSnapshots = false;
+    CONFIRM_SNAPSHOT("report", changed);
+}
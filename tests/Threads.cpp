@@ -0,0 +1,88 @@
+#include "../Test.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+TEST("Test confirm failure on another thread is captured")
+{
+    std::string reason = "    Expected: 1\n";
+    reason += "    Actual  : 2";
+    setExpectedFailureReason(reason);
+
+    std::thread worker([]
+    {
+        CONFIRM(1, 2);
+    });
+    worker.join();
+}
+
+TEST("Test stress runs every iteration on every thread")
+{
+    std::atomic<int> count = 0;
+
+    STRESS(4, 1000)
+    {
+        ++count;
+    };
+
+    CONFIRM(4000, count.load());
+}
+
+TEST("Test stress confirm failure")
+{
+    setExpectedFailureReason("    Expected: false");
+
+    std::atomic<int> count = 0;
+    STRESS(2, 10)
+    {
+        CONFIRM_FALSE(++count == 15);
+    };
+}
+
+TEST("Test stress confirm failure ends the iteration")
+{
+    std::atomic<int> afterFailure = 0;
+    try
+    {
+        STRESS(2, 10)
+        {
+            CONFIRM_TRUE(false);
+            ++afterFailure;
+        };
+    }
+    catch (TDD::ConfirmException const &)
+    {
+    }
+    CONFIRM(0, afterFailure.load());
+}
+
+namespace
+{
+    class NoResources
+    {
+    public:
+        void setup() {}
+
+        void teardown() {}
+    };
+}
+
+// A failure on another thread fails every async test of the suite that was
+// running at the time, so this test has a suite of its own.
+TDD::TestSuiteSetupAndTeardown<NoResources>
+    gAsyncThreads("Async threads setup", "Async threads");
+
+TEST_SUITE_ASYNC("Test async confirm failure on another thread is captured", "Async threads")
+{
+    std::string reason = "    Expected: 1\n";
+    reason += "    Actual  : 2";
+    setExpectedFailureReason(reason);
+
+    std::thread worker([]
+    {
+        CONFIRM(1, 2);
+    });
+    worker.join();
+    co_return;
+}
@@ -0,0 +1,58 @@
+#include "../Test.h"
+
+#include <cstdint>
+#include <vector>
+
+TEST("Test trace scope can be used in a test")
+{
+    TDD_TRACE_SCOPE("Outer span");
+    {
+        TDD_TRACE_SCOPE("Inner span");
+    }
+}
+
+TEST("Test trace buffer keeps newest whole spans when full")
+{
+    auto buffer = std::make_unique<TDD::TraceBuffer>(1);
+    std::uint64_t extra = 5;
+    for (std::uint64_t i = 0; i < TDD::TraceBuffer::capacity + extra; ++i)
+    {
+        auto start = static_cast<std::int64_t>(2 * i);
+        buffer->record("span", "test", 'X', start, 1);
+    }
+
+    std::int64_t first = -1;
+    std::uint64_t count = 0;
+    bool whole = true;
+    buffer->forEach([&](TDD::TraceEvent const &event)
+    {
+        if (count == 0)
+        {
+            first = event.timestamp;
+        }
+        ++count;
+        whole = whole && event.phase == 'X' && event.duration == 1;
+    });
+    CONFIRM(TDD::TraceBuffer::capacity, count);
+    CONFIRM(static_cast<std::int64_t>(2 * extra), first);
+    CONFIRM_TRUE(whole);
+}
+
+TEST("Test trace buffer keeps the id of each async span")
+{
+    auto buffer = std::make_unique<TDD::TraceBuffer>(1);
+    int first = 0;
+    int second = 0;
+    // Two tests may share one name, and the compiler may merge equal literals.
+    buffer->record("Same name", "async", 'b', 0, 10, nullptr, &first);
+    buffer->record("Same name", "async", 'b', 5, 10, nullptr, &second);
+
+    std::vector<void const *> ids;
+    buffer->forEach([&](TDD::TraceEvent const &event)
+    {
+        ids.push_back(event.id);
+    });
+    CONFIRM(2, static_cast<int>(ids.size()));
+    CONFIRM_TRUE(ids[0] == &first);
+    CONFIRM_TRUE(ids[1] == &second);
+}
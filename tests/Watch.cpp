@@ -0,0 +1,169 @@
+#include "../Test.h"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+
+#if defined(__linux__)
+namespace
+{
+    int countOpenDescriptors()
+    {
+        std::filesystem::directory_iterator descriptors("/proc/self/fd");
+        return static_cast<int>(std::distance(descriptors, std::filesystem::directory_iterator()));
+    }
+
+    // Two builds of one test object. Both define the Shared suite, so its
+    // registry key views a name that goes away when the object is unloaded.
+    constexpr char const *librarySource = R"(
+struct NoResources
+{
+    void setup() {}
+    void teardown() {}
+};
+
+TDD::TestSuiteSetupAndTeardown<NoResources> gSharedSuite("Shared suite", "Shared");
+
+TEST_SUITE(TEST_NAME, "Shared")
+{
+}
+)";
+
+    // Loads the first build, registers a test of its own in the same suite,
+    // then loads the rebuild over the first one and finally deletes it.
+    constexpr char const *serverSource = R"(
+#include <filesystem>
+#include <iostream>
+
+class HostTest : public TDD::Test
+{
+public:
+    HostTest()
+        : Test("Host test", "Shared") {}
+
+    void run() override {}
+};
+
+void printRegistry(char const *when)
+{
+    std::cout << "Registry " << when << ":";
+    for (auto const &[suiteName, tests] : TDD::getTests())
+    {
+        std::cout << " [" << suiteName << "]";
+        for (auto const *test : tests)
+        {
+            std::cout << " " << test->name();
+        }
+    }
+    std::cout << std::endl;
+}
+
+int main(int, char const **argv)
+{
+    std::filesystem::path watched = argv[1];
+    std::filesystem::path library = watched / "tests.so";
+    auto const overwrite = std::filesystem::copy_options::overwrite_existing;
+    TDD::WatchServer server(watched);
+
+    std::filesystem::copy_file(argv[2], library, overwrite);
+    server.reload({library});
+    HostTest host;
+    printRegistry("after load");
+
+    std::filesystem::copy_file(argv[3], library, overwrite);
+    server.reload({library});
+    printRegistry("after rebuild");
+
+    std::filesystem::remove(library);
+    server.reload({library});
+    printRegistry("after delete");
+    return 0;
+}
+)";
+
+    std::string readText(std::filesystem::path const &path)
+    {
+        std::ifstream file(path);
+        std::ostringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+
+    int countOf(std::string const &text, std::string const &part)
+    {
+        int count = 0;
+        for (auto found = text.find(part); found != std::string::npos; found = text.find(part, found + 1))
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    // Compiles source after an include of this repository's Test.h.
+    int compile(std::filesystem::path const &source, std::string const &text, std::string const &flags)
+    {
+        std::filesystem::path header = std::filesystem::absolute(std::filesystem::path(__FILE__).parent_path() / ".." / "Test.h");
+        std::ofstream(source) << "#include \"" << header.lexically_normal().string() << "\"\n" << text;
+        char const *compiler = std::getenv("CXX");
+        std::string command = std::string(compiler != nullptr ? compiler : "g++") + " -std=c++20 " + flags;
+        return std::system(command.c_str());
+    }
+}
+
+TEST("Test watch server fails on a missing directory")
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "tdd_watch_missing";
+    std::filesystem::remove_all(directory);
+    int before = countOpenDescriptors();
+
+    CONFIRM(1, TDD::WatchServer(directory).run());
+    CONFIRM(before, countOpenDescriptors());
+}
+
+TEST("Test watch server fails on a file that is not a directory")
+{
+    std::filesystem::path file = std::filesystem::temp_directory_path() / "tdd_watch_file.so";
+    std::ofstream(file) << "not a directory";
+    int before = countOpenDescriptors();
+
+    int result = TDD::WatchServer(file / "tests").run();
+    int after = countOpenDescriptors();
+    std::filesystem::remove(file);
+    CONFIRM(1, result);
+    CONFIRM(before, after);
+}
+
+TEST("Test watch server reloads a rebuilt object and runs only its new tests")
+{
+    std::filesystem::path directory = std::filesystem::temp_directory_path() / "tdd_watch_reload";
+    std::filesystem::path watched = directory / "watched";
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(watched);
+    std::string base = directory.string() + "/";
+
+    // The objects stay out of the watched directory until they are copied
+    // in, as a build would replace them.
+    CONFIRM(0, compile(directory / "first.cpp", "#define TEST_NAME \"Test first build\"\n" + std::string(librarySource),
+                       "-shared -fPIC -fno-gnu-unique " + base + "first.cpp -o " + base + "first.so"));
+    CONFIRM(0, compile(directory / "second.cpp", "#define TEST_NAME \"Test second build\"\n" + std::string(librarySource),
+                       "-shared -fPIC -fno-gnu-unique " + base + "second.cpp -o " + base + "second.so"));
+    CONFIRM(0, compile(directory / "server.cpp", serverSource,
+                       "-rdynamic " + base + "server.cpp -o " + base + "server -ldl"));
+    std::string command = base + "server " + watched.string() + " " + base + "first.so " + base + "second.so > " +
+                          base + "output.txt 2>&1";
+    CONFIRM(0, std::system(command.c_str()));
+
+    std::string output = readText(directory / "output.txt");
+    std::filesystem::remove_all(directory);
+    CONFIRM(1, countOf(output, "Test: Test first build\n"));
+    CONFIRM(1, countOf(output, "Test: Test second build\n"));
+    CONFIRM(0, countOf(output, "Test: Host test\n"));
+    CONFIRM(1, countOf(output, "Registry after load: [Shared] Test first build Host test\n"));
+    CONFIRM(1, countOf(output, "Registry after rebuild: [Shared] Host test Test second build\n"));
+    CONFIRM(1, countOf(output, "Removed " + (watched / "tests.so").string() + "\n"));
+    CONFIRM(1, countOf(output, "Registry after delete: [Shared] Host test\n"));
+}
+#endif
@@ -5,7 +5,7 @@
 int main(int argc, const char **argv)
 {
 
-    TDD::runTests();
+    TDD::runTests(argc, argv);
     /*
     std::ofstream file("output.txt");
 